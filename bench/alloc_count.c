@@ -0,0 +1,28 @@
+#include "alloc_count.h"
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef strdup
+
+unsigned long bench_allocations = 0;
+
+void* bench_malloc(size_t size) {
+    bench_allocations++;
+    return malloc(size);
+}
+
+void* bench_calloc(size_t count, size_t size) {
+    bench_allocations++;
+    return calloc(count, size);
+}
+
+void* bench_realloc(void *pointer, size_t size) {
+    bench_allocations++;
+    return realloc(pointer, size);
+}
+
+char* bench_strdup(const char *text) {
+    bench_allocations++;
+    return strdup(text);
+}
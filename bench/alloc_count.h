@@ -0,0 +1,22 @@
+// Force-included (-include) into every source of a benchmark so the heap
+// calls made by the code under test are counted in bench_allocations.
+#ifndef CONDUIT_ALLOC_COUNT_H
+#define CONDUIT_ALLOC_COUNT_H
+
+// The real declarations have to be seen before the macros below
+#include <stdlib.h>
+#include <string.h>
+
+extern unsigned long bench_allocations;
+
+void* bench_malloc(size_t size);
+void* bench_calloc(size_t count, size_t size);
+void* bench_realloc(void *pointer, size_t size);
+char* bench_strdup(const char *text);
+
+#define malloc(size) bench_malloc(size)
+#define calloc(count, size) bench_calloc(count, size)
+#define realloc(pointer, size) bench_realloc(pointer, size)
+#define strdup(text) bench_strdup(text)
+
+#endif
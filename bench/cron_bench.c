@@ -0,0 +1,355 @@
+// Microbenchmarks of the cron layer over a realistic mix of expressions:
+// the interpreted matcher (match_cron_field and the is_time_to_run loop the
+// schedulers used before schedules were compiled), compiling, compiled
+// matching, next fire, interning and the column table.
+// Reports ns/op and heap allocations/op, --json prints the same as JSON.
+// First checks that malformed expressions are rejected and cron_next_fire
+// across the end of DST, and fails on a mismatch.
+// Usage: cron_bench [--json] [catalog sizes...]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cron.h"
+#include "cron_table.h"
+#include "alloc_count.h"
+
+#define BENCH_START 1700006400  // 2023-11-15 00:00 UTC
+#define BENCH_INSTANTS 4096
+// Every case runs at least this many ops, and at least one per expression
+#define MIN_OPS 1000000L
+
+typedef struct BenchExpression {
+    char text[64];
+    char fields[5][24];
+    CronSchedule schedule;
+    const CronSchedule *interned;  // keeps the expression interned for the lookups
+} BenchExpression;
+
+typedef struct BenchSet {
+    BenchExpression *expressions;
+    int count;
+    struct CronTime times[BENCH_INSTANTS];
+    CronTable table;
+} BenchSet;
+
+typedef long (*BenchCase)(BenchSet *set, long ops);
+
+static const int field_min[5] = { 0, 0, 1, 1, 0 };
+static const int field_max[5] = { 59, 23, 31, 12, 6 };
+
+// Mostly plain daily and hourly jobs, then steps, ranges, lists and mixes of them
+static void random_expression(char *buffer, size_t size) {
+    int pick = rand() % 100;
+    int minute = rand() % 60, hour = rand() % 24;
+    if (pick < 40) {
+        snprintf(buffer, size, "%d %d * * *", minute, hour);
+    } else if (pick < 55) {
+        snprintf(buffer, size, "%d * * * *", minute);
+    } else if (pick < 65) {
+        snprintf(buffer, size, "*/%d * * * *", 5 + rand() % 26);
+    } else if (pick < 75) {
+        snprintf(buffer, size, "%d %d-%d * * 1-5", minute, rand() % 9, 12 + rand() % 12);
+    } else if (pick < 85) {
+        snprintf(buffer, size, "%d,%d,%d %d * * *", rand() % 20, 20 + rand() % 20, 40 + rand() % 20, hour);
+    } else if (pick < 90) {
+        snprintf(buffer, size, "%d %d %d * *", minute, hour, 1 + rand() % 28);
+    } else if (pick < 95) {
+        snprintf(buffer, size, "%d %d * * %d", minute, hour, rand() % 7);
+    } else {
+        snprintf(buffer, size, "%d */%d 1,15 %d-%d *", minute, 2 + rand() % 5, 1 + rand() % 6, 7 + rand() % 6);
+    }
+}
+
+// The matcher the schedulers ran on every tick before cron_compile existed
+static int is_time_to_run(const char *expression, struct CronTime now) {
+    char *fields[5];
+    char *copy = strdup(expression);
+    char *token = strtok(copy, " ");
+
+    for (int i = 0; i < 5; i++) {
+        if (!token) {
+            free(copy);
+            return 0;
+        }
+        fields[i] = token;
+        token = strtok(NULL, " ");
+    }
+
+    int result = 1;
+    result &= match_cron_field(fields[0], now.minute, 0, 59);
+    result &= match_cron_field(fields[1], now.hour, 0, 23);
+    result &= match_cron_field(fields[2], now.day_of_month, 1, 31);
+    result &= match_cron_field(fields[3], now.month, 1, 12);
+    result &= match_cron_field(fields[4], now.day_of_week, 0, 6);
+
+    free(copy);
+    return result;
+}
+
+static int field_value(struct CronTime now, int field) {
+    switch (field) {
+    case 0: return now.minute;
+    case 1: return now.hour;
+    case 2: return now.day_of_month;
+    case 3: return now.month;
+    default: return now.day_of_week;
+    }
+}
+
+static long bench_match_cron_field(BenchSet *set, long ops) {
+    long checksum = 0;
+    for (long op = 0; op < ops; op++) {
+        BenchExpression *expression = &set->expressions[op % set->count];
+        int field = op % 5;
+        int value = field_value(set->times[op % BENCH_INSTANTS], field);
+        checksum += match_cron_field(expression->fields[field], value, field_min[field], field_max[field]);
+    }
+    return checksum;
+}
+
+static long bench_is_time_to_run(BenchSet *set, long ops) {
+    long checksum = 0;
+    for (long op = 0; op < ops; op++) {
+        checksum += is_time_to_run(set->expressions[op % set->count].text, set->times[op % BENCH_INSTANTS]);
+    }
+    return checksum;
+}
+
+static long bench_cron_compile(BenchSet *set, long ops) {
+    long checksum = 0;
+    CronSchedule schedule;
+    for (long op = 0; op < ops; op++) {
+        checksum += cron_compile(set->expressions[op % set->count].text, &schedule) == 0;
+    }
+    return checksum;
+}
+
+static long bench_cron_compile_seeded(BenchSet *set, long ops) {
+    static const char *hashed[] = { "H H * * *", "H/15 * * * *", "H H(9-17) * * 1-5", "H H 1,15 * *" };
+    long checksum = 0;
+    CronSchedule schedule;
+    for (long op = 0; op < ops; op++) {
+        checksum += cron_compile_seeded(hashed[op % 4], set->expressions[op % set->count].text, &schedule) == 0;
+    }
+    return checksum;
+}
+
+// Same pairs of expression and instant as is_time_to_run, so the checksums agree
+static long bench_cron_matches(BenchSet *set, long ops) {
+    long checksum = 0;
+    for (long op = 0; op < ops; op++) {
+        checksum += cron_matches(&set->expressions[op % set->count].schedule, set->times[op % BENCH_INSTANTS]);
+    }
+    return checksum;
+}
+
+static long bench_cron_next_fire(BenchSet *set, long ops) {
+    long checksum = 0;
+    for (long op = 0; op < ops; op++) {
+        time_t after = BENCH_START + (op * 7919) % (86400 * 7);
+        checksum += cron_next_fire(&set->expressions[op % set->count].schedule, after) - after;
+    }
+    return checksum;
+}
+
+// Lookups of expressions already interned, what every DAG load does
+static long bench_cron_intern(BenchSet *set, long ops) {
+    long checksum = 0;
+    for (long op = 0; op < ops; op++) {
+        const CronSchedule *schedule = cron_intern(set->expressions[op % set->count].text);
+        checksum += schedule->valid;
+        cron_release(schedule);
+    }
+    return checksum;
+}
+
+// One op is one schedule evaluated by the table pass
+static long bench_cron_table_due(BenchSet *set, long ops) {
+    uint64_t *due = malloc(CRON_TABLE_WORDS(set->count) * sizeof(uint64_t));
+    long passes = (ops + set->count - 1) / set->count;
+    long checksum = 0;
+    for (long pass = 0; pass < passes; pass++) {
+        checksum += cron_table_due(&set->table, set->times[pass % BENCH_INSTANTS], due);
+    }
+    free(due);
+    return checksum;
+}
+
+static const struct {
+    const char *name;
+    BenchCase run;
+} bench_cases[] = {
+    { "match_cron_field", bench_match_cron_field },
+    { "is_time_to_run", bench_is_time_to_run },
+    { "cron_compile", bench_cron_compile },
+    { "cron_compile_seeded", bench_cron_compile_seeded },
+    { "cron_matches", bench_cron_matches },
+    { "cron_next_fire", bench_cron_next_fire },
+    { "cron_intern", bench_cron_intern },
+    { "cron_table_due", bench_cron_table_due },
+};
+
+static void split_fields(BenchExpression *expression) {
+    const char *p = expression->text;
+    for (int field = 0; field < 5; field++) {
+        while (*p == ' ') p++;
+        size_t length = strcspn(p, " ");
+        if (length >= sizeof(expression->fields[field])) length = sizeof(expression->fields[field]) - 1;
+        memcpy(expression->fields[field], p, length);
+        expression->fields[field][length] = '\0';
+        p += strcspn(p, " ");
+    }
+}
+
+static int check_rejected_expressions(void) {
+    static const char *malformed[] = { "1, * * * *", ",1 * * * *", "1,,2 * * * *", "* * * * 1," };
+    int mismatches = 0;
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        CronSchedule schedule;
+        if (cron_compile(malformed[i], &schedule) == 0) {
+            fprintf(stderr, "MISMATCH cron_compile(\"%s\") accepted\n", malformed[i]);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// Fires around the end of DST in New York, 2024-11-03, where 01:00-01:59
+// comes twice: at 06:00 UTC 01:59:59 EDT is followed by 01:00:00 EST
+static int check_dst_fall_back(void) {
+    static const struct {
+        const char *expression;
+        time_t after;
+        time_t expected;
+    } cases[] = {
+        { "*/15 * * * *", 1730611800, 1730612700 },  // 01:30 EDT -> 01:45 EDT
+        { "*/15 * * * *", 1730613000, 1730613600 },  // 01:50 EDT -> 01:00 EST
+        { "*/15 * * * *", 1730614500, 1730615400 },  // 01:15 EST -> 01:30 EST
+        { "30 1 * * *", 1730611800, 1730615400 },    // 01:30 EDT -> 01:30 EST
+        { "0 2 * * *", 1730613600, 1730617200 },     // 01:00 EST -> 02:00 EST
+    };
+
+    char *saved = getenv("TZ") ? strdup(getenv("TZ")) : NULL;
+    setenv("TZ", "America/New_York", 1);
+    tzset();
+
+    int mismatches = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        CronSchedule schedule;
+        cron_compile(cases[i].expression, &schedule);
+        time_t next = cron_next_fire(&schedule, cases[i].after);
+        if (next != cases[i].expected) {
+            fprintf(stderr, "MISMATCH cron_next_fire(\"%s\", %ld) = %ld, expected %ld\n", cases[i].expression,
+                    (long)cases[i].after, (long)next, (long)cases[i].expected);
+            mismatches++;
+        }
+    }
+
+    if (saved) {
+        setenv("TZ", saved, 1);
+        free(saved);
+    } else {
+        unsetenv("TZ");
+    }
+    tzset();
+    return mismatches;
+}
+
+static int run_size(int count, int json, int *first_result) {
+    BenchSet *set = malloc(sizeof(BenchSet));
+    if (!set) return -1;
+    set->expressions = calloc(count, sizeof(BenchExpression));
+    if (!set->expressions) {
+        free(set);
+        return -1;
+    }
+    set->count = count;
+
+    srand(42);
+    cron_table_init(&set->table);
+    for (int i = 0; i < count; i++) {
+        BenchExpression *expression = &set->expressions[i];
+        random_expression(expression->text, sizeof(expression->text));
+        split_fields(expression);
+        cron_compile(expression->text, &expression->schedule);
+        cron_table_append(&set->table, &expression->schedule);
+        expression->interned = cron_intern(expression->text);
+    }
+    // Spread over a week so hours, days and weekdays all vary
+    for (int i = 0; i < BENCH_INSTANTS; i++) {
+        set->times[i] = cron_time_at(BENCH_START + (time_t)i * 147 * 60);
+    }
+
+    long ops = count > MIN_OPS ? count : MIN_OPS;
+    long interpreted = 0;
+    for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++) {
+        struct timespec start, end;
+        unsigned long allocations = bench_allocations;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long checksum = bench_cases[c].run(set, ops);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+        double allocs = (double)(bench_allocations - allocations) / ops;
+        if (bench_cases[c].run == bench_is_time_to_run) interpreted = checksum;
+        // The compiled matcher has to find exactly what the interpreted one did
+        int mismatch = bench_cases[c].run == bench_cron_matches && checksum != interpreted;
+
+        if (json) {
+            printf("%s\n    {\"case\":\"%s\",\"expressions\":%d,\"ops\":%ld,\"ns_per_op\":%.2f,"
+                   "\"allocs_per_op\":%.3f,\"checksum\":%ld%s}",
+                   *first_result ? "" : ",", bench_cases[c].name, count, ops, ns / ops, allocs, checksum,
+                   mismatch ? ",\"mismatch\":true" : "");
+            *first_result = 0;
+        } else {
+            printf("%-20s %9d %9ld %10.2f %10.3f %14ld%s\n", bench_cases[c].name, count, ops,
+                   ns / ops, allocs, checksum, mismatch ? "  MISMATCH" : "");
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        cron_release(set->expressions[i].interned);
+    }
+    cron_table_free(&set->table);
+    free(set->expressions);
+    free(set);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static const int default_sizes[] = {1000, 10000, 100000, 1000000};
+    int sizes[32];
+    int size_count = 0;
+    int json = 0;
+    int first_result = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (atoi(argv[i]) > 0 && size_count < 32) {
+            sizes[size_count++] = atoi(argv[i]);
+        }
+    }
+    if (size_count == 0) {
+        for (int i = 0; i < 4; i++) sizes[size_count++] = default_sizes[i];
+    }
+    if (check_rejected_expressions() + check_dst_fall_back() != 0) return 1;
+
+    if (json) {
+        printf("{\"benchmark\":\"cron\",\"start\":%d,\"results\":[", BENCH_START);
+    } else {
+        printf("%-20s %9s %9s %10s %10s %14s\n", "case", "exprs", "ops", "ns/op", "allocs/op", "checksum");
+    }
+
+    for (int i = 0; i < size_count; i++) {
+        if (run_size(sizes[i], json, &first_result) != 0) {
+            fprintf(stderr, "Out of memory for %d expressions\n", sizes[i]);
+            return 1;
+        }
+    }
+
+    if (json) printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Throughput of the column table "who is due" pass for each kernel the CPU
+// supports, against one cron_matches call per schedule.
+// Usage: cron_table_bench [seconds] [catalog sizes...]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cron.h"
+#include "cron_table.h"
+
+#define BENCH_START 1700006400  // 2023-11-15 00:00 UTC
+#define DEFAULT_SECONDS 3600
+// Probes per run are scaled down for big catalogs so every size takes similar time
+#define PROBE_BUDGET 200000000LL
+
+static double elapsed_us(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e6 + (end.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+// Daily jobs dominate, with hourly, stepped, ranged, listed and per-second ones
+static void random_expression(char *buffer, size_t size) {
+    int pick = rand() % 100;
+    if (pick < 70) {
+        snprintf(buffer, size, "%d %d * * *", rand() % 60, rand() % 24);
+    } else if (pick < 82) {
+        snprintf(buffer, size, "%d * * * *", rand() % 60);
+    } else if (pick < 88) {
+        snprintf(buffer, size, "*/%d * * * *", 5 + rand() % 26);
+    } else if (pick < 93) {
+        snprintf(buffer, size, "%d %d-%d * * 1-5", rand() % 60, rand() % 8, 12 + rand() % 12);
+    } else if (pick < 97) {
+        snprintf(buffer, size, "%d,%d %d * * %d", rand() % 30, 30 + rand() % 30, rand() % 24, rand() % 7);
+    } else {
+        snprintf(buffer, size, "*/%d * * * * *", 10 + rand() % 21);
+    }
+}
+
+// Instants are converted up front so localtime_r isn't part of the measurement
+static long bench_matches(const CronSchedule *schedules, int count, const struct CronTime *times, int seconds, double *us) {
+    struct timespec start;
+    long due = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int second = 0; second < seconds; second++) {
+        for (int i = 0; i < count; i++) {
+            due += cron_matches(&schedules[i], times[second]);
+        }
+    }
+    *us = elapsed_us(&start);
+    return due;
+}
+
+static long bench_table(const CronTable *table, const struct CronTime *times, int seconds, uint64_t *bitmap, double *us) {
+    struct timespec start;
+    long due = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int second = 0; second < seconds; second++) {
+        due += cron_table_due(table, times[second], bitmap);
+    }
+    *us = elapsed_us(&start);
+    return due;
+}
+
+// Every kernel has to agree with cron_matches bit for bit
+static int verify_table(const CronSchedule *schedules, const CronTable *table, uint64_t *bitmap) {
+    for (int second = 0; second < 86400 * 7; second += 1009) {
+        struct CronTime now = cron_time_at(BENCH_START + second);
+        cron_table_due(table, now, bitmap);
+        for (int i = 0; i < table->count; i++) {
+            if ((int)(bitmap[i / 64] >> (i % 64) & 1) != cron_matches(&schedules[i], now)) return -1;
+        }
+    }
+    return 0;
+}
+
+static void run_size(int count, int seconds) {
+    static const CronTableKernel kernels[] = { CRON_KERNEL_SCALAR, CRON_KERNEL_SSE2, CRON_KERNEL_AVX2 };
+    CronSchedule *schedules = calloc(count, sizeof(CronSchedule));
+    uint64_t *bitmap = calloc(CRON_TABLE_WORDS(count), sizeof(uint64_t));
+    struct CronTime *times = malloc(seconds * sizeof(struct CronTime));
+    CronTable table;
+    char expression[64];
+
+    if (!schedules || !bitmap || !times) {
+        fprintf(stderr, "Out of memory for %d schedules\n", count);
+        free(schedules);
+        free(bitmap);
+        free(times);
+        return;
+    }
+
+    cron_table_init(&table);
+    srand(42);
+    for (int i = 0; i < count; i++) {
+        random_expression(expression, sizeof(expression));
+        cron_compile(expression, &schedules[i]);
+        cron_table_append(&table, &schedules[i]);
+    }
+
+    if ((long long)count * seconds > PROBE_BUDGET) seconds = (int)(PROBE_BUDGET / count);
+    if (seconds < 1) seconds = 1;
+    for (int second = 0; second < seconds; second++) {
+        times[second] = cron_time_at(BENCH_START + second);
+    }
+
+    double us;
+    long expected = bench_matches(schedules, count, times, seconds, &us);
+    printf("%9d %8d %10s %10ld %12.1f %10.1f\n", count, seconds, "matches", expected, us / 1e3,
+           (double)count * seconds / us);
+
+    for (int k = 0; k < 3; k++) {
+        if (cron_table_use_kernel(kernels[k]) != 0) continue;
+        long due = bench_table(&table, times, seconds, bitmap, &us);
+        int mismatch = due != expected || verify_table(schedules, &table, bitmap) != 0;
+        printf("%9d %8d %10s %10ld %12.1f %10.1f%s\n", count, seconds, cron_table_kernel_name(kernels[k]),
+               due, us / 1e3, (double)count * seconds / us, mismatch ? "  MISMATCH" : "");
+    }
+    cron_table_use_kernel(CRON_KERNEL_AUTO);
+
+    cron_table_free(&table);
+    free(bitmap);
+    free(times);
+    free(schedules);
+}
+
+int main(int argc, char *argv[]) {
+    int seconds = argc > 1 ? atoi(argv[1]) : DEFAULT_SECONDS;
+    static const int default_sizes[] = {1000, 10000, 100000, 1000000};
+
+    if (seconds <= 0) seconds = DEFAULT_SECONDS;
+
+    printf("Evaluating which schedules are due, once per simulated second (time in ms)\n");
+    printf("%9s %8s %10s %10s %12s %10s\n", "schedules", "seconds", "method", "due", "time", "sched/us");
+
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) run_size(atoi(argv[i]), seconds);
+    } else {
+        for (int i = 0; i < 4; i++) run_size(default_sizes[i], seconds);
+    }
+    return 0;
+}
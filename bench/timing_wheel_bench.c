@@ -0,0 +1,203 @@
+// Compares the ways dag_scheduler() can find due DAGs over a simulated window:
+// a linear scan of every schedule each minute, the min-heap and the timing wheel.
+// Usage: timing_wheel_bench [minutes] [catalog sizes...]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cron.h"
+#include "stack.h"
+#include "timing_wheel.h"
+
+#define BENCH_START 1700006400  // 2023-11-15 00:00 UTC
+#define DEFAULT_MINUTES 360
+
+typedef struct BenchEntry {
+    CronSchedule schedule;
+    time_t first_fire;
+    TimerNode heap_node;
+    WheelNode wheel_node;
+} BenchEntry;
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 + (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Mostly daily jobs with some hourly, quarter-hourly and weekly ones
+static void random_expression(char *buffer, size_t size) {
+    int pick = rand() % 100;
+    if (pick < 85) {
+        snprintf(buffer, size, "%d %d * * *", rand() % 60, rand() % 24);
+    } else if (pick < 95) {
+        snprintf(buffer, size, "%d * * * *", rand() % 60);
+    } else if (pick < 99) {
+        snprintf(buffer, size, "*/15 * * * *");
+    } else {
+        snprintf(buffer, size, "%d %d * * %d", rand() % 60, rand() % 24, rand() % 7);
+    }
+}
+
+static long bench_scan(BenchEntry *entries, int count, int minutes, double *ms) {
+    struct timespec start;
+    long fires = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int minute = 1; minute <= minutes; minute++) {
+        struct CronTime now = cron_time_at(BENCH_START + minute * 60);
+        for (int i = 0; i < count; i++) {
+            fires += cron_matches(&entries[i].schedule, now);
+        }
+    }
+    *ms = elapsed_ms(&start);
+    return fires;
+}
+
+static long bench_heap(BenchEntry *entries, int count, int minutes, double *setup_ms, double *ms) {
+    TimerHeap heap;
+    struct timespec start;
+    long fires = 0;
+
+    timer_heap_init(&heap);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        timer_node_init(&entries[i].heap_node, &entries[i]);
+        if (entries[i].first_fire != -1) timer_heap_push(&heap, &entries[i].heap_node, entries[i].first_fire);
+    }
+    *setup_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int minute = 1; minute <= minutes; minute++) {
+        time_t now = BENCH_START + minute * 60;
+        TimerNode *node;
+        while ((node = timer_heap_peek(&heap)) != NULL && node->due <= now) {
+            BenchEntry *entry = node->owner;
+            timer_heap_pop(&heap);
+            fires++;
+            time_t next = cron_next_fire(&entry->schedule, now);
+            if (next != -1) timer_heap_push(&heap, node, next);
+        }
+    }
+    *ms = elapsed_ms(&start);
+
+    timer_heap_free(&heap);
+    return fires;
+}
+
+static long bench_wheel(BenchEntry *entries, int count, int minutes, double *setup_ms, double *ms) {
+    TimingWheel *wheel = malloc(sizeof(TimingWheel));
+    struct timespec start;
+    long fires = 0;
+
+    timing_wheel_init(wheel, BENCH_START);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        wheel_node_init(&entries[i].wheel_node, &entries[i]);
+        if (entries[i].first_fire != -1) timing_wheel_insert(wheel, &entries[i].wheel_node, entries[i].first_fire);
+    }
+    *setup_ms = elapsed_ms(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int minute = 1; minute <= minutes; minute++) {
+        time_t now = BENCH_START + minute * 60;
+        WheelNode *node;
+        timing_wheel_advance(wheel, now);
+        while ((node = timing_wheel_pop_expired(wheel)) != NULL) {
+            BenchEntry *entry = node->owner;
+            fires++;
+            time_t next = cron_next_fire(&entry->schedule, now);
+            if (next != -1) timing_wheel_insert(wheel, node, next);
+        }
+    }
+    *ms = elapsed_ms(&start);
+
+    free(wheel);
+    return fires;
+}
+
+// Cancel + re-insert of random entries, what /api/dag create/delete churn costs
+static void bench_churn(BenchEntry *entries, int count, double *heap_ns, double *wheel_ns) {
+    int operations = count < 100000 ? count : 100000;
+    TimerHeap heap;
+    TimingWheel *wheel = malloc(sizeof(TimingWheel));
+    struct timespec start;
+
+    timer_heap_init(&heap);
+    timing_wheel_init(wheel, BENCH_START);
+    for (int i = 0; i < count; i++) {
+        timer_node_init(&entries[i].heap_node, &entries[i]);
+        wheel_node_init(&entries[i].wheel_node, &entries[i]);
+        timer_heap_push(&heap, &entries[i].heap_node, BENCH_START + 60 + rand() % 86400);
+        timing_wheel_insert(wheel, &entries[i].wheel_node, BENCH_START + 60 + rand() % 86400);
+    }
+
+    srand(7);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int op = 0; op < operations; op++) {
+        BenchEntry *entry = &entries[rand() % count];
+        timer_heap_remove(&heap, &entry->heap_node);
+        timer_heap_push(&heap, &entry->heap_node, BENCH_START + 60 + rand() % 86400);
+    }
+    *heap_ns = elapsed_ms(&start) * 1e6 / operations;
+
+    srand(7);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int op = 0; op < operations; op++) {
+        BenchEntry *entry = &entries[rand() % count];
+        timing_wheel_cancel(wheel, &entry->wheel_node);
+        timing_wheel_insert(wheel, &entry->wheel_node, BENCH_START + 60 + rand() % 86400);
+    }
+    *wheel_ns = elapsed_ms(&start) * 1e6 / operations;
+
+    timer_heap_free(&heap);
+    free(wheel);
+}
+
+static void run_size(int count, int minutes) {
+    BenchEntry *entries = calloc(count, sizeof(BenchEntry));
+    char expression[64];
+    double scan_ms, heap_setup_ms, heap_ms, wheel_setup_ms, wheel_ms, heap_churn_ns, wheel_churn_ns;
+
+    if (!entries) {
+        fprintf(stderr, "Out of memory for %d schedules\n", count);
+        return;
+    }
+
+    srand(42);
+    for (int i = 0; i < count; i++) {
+        random_expression(expression, sizeof(expression));
+        cron_compile(expression, &entries[i].schedule);
+        entries[i].first_fire = cron_next_fire(&entries[i].schedule, BENCH_START);
+    }
+
+    long scan_fires = bench_scan(entries, count, minutes, &scan_ms);
+    long heap_fires = bench_heap(entries, count, minutes, &heap_setup_ms, &heap_ms);
+    long wheel_fires = bench_wheel(entries, count, minutes, &wheel_setup_ms, &wheel_ms);
+    bench_churn(entries, count, &heap_churn_ns, &wheel_churn_ns);
+
+    printf("%9d %8ld %12.2f %12.2f %12.2f %12.2f %12.2f %10.1f %10.1f%s\n",
+           count, scan_fires, scan_ms, heap_setup_ms, heap_ms, wheel_setup_ms, wheel_ms,
+           heap_churn_ns, wheel_churn_ns,
+           (scan_fires == heap_fires && scan_fires == wheel_fires) ? "" : "  MISMATCH");
+
+    free(entries);
+}
+
+int main(int argc, char *argv[]) {
+    int minutes = argc > 1 ? atoi(argv[1]) : DEFAULT_MINUTES;
+    static const int default_sizes[] = {10000, 100000, 1000000};
+
+    if (minutes <= 0) minutes = DEFAULT_MINUTES;
+
+    printf("Simulating %d minutes of dispatch (times in ms, churn in ns/op)\n", minutes);
+    printf("%9s %8s %12s %12s %12s %12s %12s %10s %10s\n",
+           "schedules", "fires", "scan", "heap_setup", "heap", "wheel_setup", "wheel", "heap_chrn", "wheel_chrn");
+
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) run_size(atoi(argv[i]), minutes);
+    } else {
+        for (int i = 0; i < 3; i++) run_size(default_sizes[i], minutes);
+    }
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include <errno.h>
+#include "clock_source.h"
+#include "logger.h"
+
+#define NS_PER_SECOND 1000000000LL
+
+static ClockSourceMode clock_mode = CLOCK_SOURCE_REAL;
+static double clock_speed = 1;
+// Accelerated time: sim_origin_ns was the simulated instant at real_origin_ns
+static long long sim_origin_ns = 0;
+static long long real_origin_ns = 0;
+
+// Virtual time and the attached threads waiting on it. Time only moves once
+// all of them wait, and then to the earliest deadline of any waiter.
+typedef struct VirtualSleeper {
+    long long deadline_ns;
+    struct VirtualSleeper *next;
+} VirtualSleeper;
+
+static pthread_mutex_t virtual_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t virtual_moved = PTHREAD_COND_INITIALIZER;
+static long long virtual_ns = 0;
+static long long virtual_until_ns = 0;
+static int virtual_attached = 0;
+static int virtual_waiting = 0;
+static VirtualSleeper *virtual_sleepers = NULL;
+
+static long long timespec_ns(const struct timespec *value) {
+    return (long long)value->tv_sec * NS_PER_SECOND + value->tv_nsec;
+}
+
+static struct timespec ns_timespec(long long ns) {
+    struct timespec value = { .tv_sec = ns / NS_PER_SECOND, .tv_nsec = ns % NS_PER_SECOND };
+    return value;
+}
+
+static long long real_ns(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return timespec_ns(&now);
+}
+
+int clock_source_configure(ClockSourceMode mode, time_t start, double speed, time_t until) {
+    if (mode == CLOCK_SOURCE_ACCELERATED && speed <= 0) {
+        log_message("Invalid clock speed %g\n", speed);
+        return -1;
+    }
+
+    long long now_ns = real_ns(CLOCK_REALTIME);
+    long long start_ns = start > 0 ? (long long)start * NS_PER_SECOND : now_ns;
+
+    pthread_mutex_lock(&virtual_mutex);
+    clock_mode = mode;
+    clock_speed = mode == CLOCK_SOURCE_ACCELERATED ? speed : 1;
+    sim_origin_ns = start_ns;
+    real_origin_ns = now_ns;
+    virtual_ns = start_ns;
+    virtual_until_ns = (long long)until * NS_PER_SECOND;
+    pthread_mutex_unlock(&virtual_mutex);
+
+    if (mode == CLOCK_SOURCE_ACCELERATED) {
+        log_message("Clock accelerated %gx starting at %lld\n", speed, start_ns / NS_PER_SECOND);
+    } else if (mode == CLOCK_SOURCE_VIRTUAL) {
+        log_message("Clock virtual starting at %lld\n", start_ns / NS_PER_SECOND);
+    }
+    return 0;
+}
+
+ClockSourceMode clock_source_mode(void) {
+    return clock_mode;
+}
+
+void clock_now_precise(struct timespec *now) {
+    switch (clock_mode) {
+    case CLOCK_SOURCE_ACCELERATED:
+        *now = ns_timespec(sim_origin_ns + (long long)((real_ns(CLOCK_REALTIME) - real_origin_ns) * clock_speed));
+        break;
+    case CLOCK_SOURCE_VIRTUAL:
+        pthread_mutex_lock(&virtual_mutex);
+        *now = ns_timespec(virtual_ns);
+        pthread_mutex_unlock(&virtual_mutex);
+        break;
+    default:
+        // Not time(): it may read a coarser clock that still shows the
+        // previous second right after a timer wakeup
+        clock_gettime(CLOCK_REALTIME, now);
+        break;
+    }
+}
+
+time_t clock_now(void) {
+    struct timespec now;
+    clock_now_precise(&now);
+    return now.tv_sec;
+}
+
+long long clock_elapsed_ms(void) {
+    if (clock_mode == CLOCK_SOURCE_REAL) return real_ns(CLOCK_MONOTONIC) / 1000000;
+
+    struct timespec now;
+    clock_now_precise(&now);
+    return timespec_ns(&now) / 1000000;
+}
+
+void clock_source_attach(void) {
+    pthread_mutex_lock(&virtual_mutex);
+    virtual_attached++;
+    pthread_mutex_unlock(&virtual_mutex);
+}
+
+void clock_source_detach(void) {
+    pthread_mutex_lock(&virtual_mutex);
+    virtual_attached--;
+    // The remaining waiters may be all that is left
+    pthread_cond_broadcast(&virtual_moved);
+    pthread_mutex_unlock(&virtual_mutex);
+}
+
+void clock_source_to_real(const struct timespec *deadline, struct timespec *real) {
+    if (clock_mode != CLOCK_SOURCE_ACCELERATED) {
+        *real = *deadline;
+        return;
+    }
+    *real = ns_timespec(real_origin_ns + (long long)((timespec_ns(deadline) - sim_origin_ns) / clock_speed));
+}
+
+static void virtual_remove_locked(VirtualSleeper *sleeper) {
+    VirtualSleeper **link = &virtual_sleepers;
+    while (*link && *link != sleeper) link = &(*link)->next;
+    if (*link) *link = sleeper->next;
+}
+
+// Jumps to the earliest pending deadline once no attached thread is busy,
+// but never past the end of the replay window. Returns 1 when time moved.
+static int virtual_advance_locked(void) {
+    if (virtual_waiting < virtual_attached) return 0;
+
+    long long earliest = -1;
+    for (VirtualSleeper *sleeper = virtual_sleepers; sleeper; sleeper = sleeper->next) {
+        if (earliest < 0 || sleeper->deadline_ns < earliest) earliest = sleeper->deadline_ns;
+    }
+    if (virtual_until_ns > 0 && earliest > virtual_until_ns) earliest = virtual_until_ns;
+    if (earliest <= virtual_ns) return 0;
+
+    virtual_ns = earliest;
+    pthread_cond_broadcast(&virtual_moved);
+    return 1;
+}
+
+int clock_virtual_wait(pthread_mutex_t *mutex, const struct timespec *deadline, int *notified) {
+    VirtualSleeper self = { deadline ? timespec_ns(deadline) : 0, NULL };
+    int fired = 0;
+
+    // Notifications are sent with mutex held, taking ours first means none is lost
+    pthread_mutex_lock(&virtual_mutex);
+    pthread_mutex_unlock(mutex);
+
+    if (deadline) {
+        self.next = virtual_sleepers;
+        virtual_sleepers = &self;
+    }
+    virtual_waiting++;
+
+    while (1) {
+        if (deadline && virtual_ns >= self.deadline_ns) {
+            fired = 1;
+            break;
+        }
+        if (*notified) {
+            *notified = 0;
+            break;
+        }
+        if (!virtual_advance_locked()) pthread_cond_wait(&virtual_moved, &virtual_mutex);
+    }
+
+    virtual_waiting--;
+    if (deadline) virtual_remove_locked(&self);
+    pthread_mutex_unlock(&virtual_mutex);
+    pthread_mutex_lock(mutex);
+    return fired;
+}
+
+void clock_virtual_notify(int *notified) {
+    pthread_mutex_lock(&virtual_mutex);
+    *notified = 1;
+    pthread_cond_broadcast(&virtual_moved);
+    pthread_mutex_unlock(&virtual_mutex);
+}
+
+// Returns the part of the sleep left over at the end of the replay window
+static long long virtual_sleep(long long duration_ns) {
+    pthread_mutex_lock(&virtual_mutex);
+    VirtualSleeper self = { virtual_ns + duration_ns, virtual_sleepers };
+    virtual_sleepers = &self;
+    virtual_waiting++;
+
+    while (virtual_ns < self.deadline_ns && (virtual_until_ns == 0 || virtual_ns < virtual_until_ns)) {
+        if (!virtual_advance_locked()) pthread_cond_wait(&virtual_moved, &virtual_mutex);
+    }
+
+    virtual_waiting--;
+    virtual_remove_locked(&self);
+    long long left_ns = self.deadline_ns > virtual_ns ? self.deadline_ns - virtual_ns : 0;
+    pthread_mutex_unlock(&virtual_mutex);
+    return left_ns;
+}
+
+void clock_sleep_ms(long milliseconds) {
+    if (milliseconds <= 0) return;
+
+    long long duration_ns = milliseconds * 1000000LL;
+    if (clock_mode == CLOCK_SOURCE_VIRTUAL) {
+        duration_ns = virtual_sleep(duration_ns);
+        if (duration_ns == 0) return;
+    } else {
+        duration_ns = (long long)(duration_ns / clock_speed);
+    }
+
+    struct timespec duration = ns_timespec(duration_ns);
+    while (nanosleep(&duration, &duration) != 0 && errno == EINTR) {
+        // Interrupted by a signal, sleep the remainder
+    }
+}
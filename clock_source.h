@@ -0,0 +1,42 @@
+#ifndef CONDUIT_CLOCK_SOURCE_H
+#define CONDUIT_CLOCK_SOURCE_H
+
+#include <pthread.h>
+#include <time.h>
+
+// Where the schedulers and DAG runs read the time from.
+// REAL is the wall clock. ACCELERATED starts at a chosen instant and runs
+// speed times faster than the wall clock. VIRTUAL only moves when every
+// attached thread is asleep, and then jumps straight to the earliest
+// deadline, so a day of cron activity replays as fast as it can be dispatched
+// and in the same order every time. Virtual time stops at until (0 = never);
+// schedules past it don't fire and longer sleeps finish in real time.
+typedef enum {
+    CLOCK_SOURCE_REAL,
+    CLOCK_SOURCE_ACCELERATED,
+    CLOCK_SOURCE_VIRTUAL
+} ClockSourceMode;
+
+// Must be called before any thread reads the clock. start = 0 means now.
+int clock_source_configure(ClockSourceMode mode, time_t start, double speed, time_t until);
+ClockSourceMode clock_source_mode(void);
+
+time_t clock_now(void);
+void clock_now_precise(struct timespec *now);
+// Milliseconds for measuring intervals, never goes back on the real clock
+long long clock_elapsed_ms(void);
+void clock_sleep_ms(long milliseconds);
+
+// Every thread that waits on the clock counts as attached while it runs.
+// Attach before the thread is started so time can't move on before its first
+// wait, detach from the thread when it is done.
+void clock_source_attach(void);
+void clock_source_detach(void);
+// Wall clock instant an accelerated deadline falls on
+void clock_source_to_real(const struct timespec *deadline, struct timespec *real);
+// Virtual counterparts of wakeup_wait/wakeup_notify, same contract. notified
+// is the flag of the SchedulerWakeup being waited on.
+int clock_virtual_wait(pthread_mutex_t *mutex, const struct timespec *deadline, int *notified);
+void clock_virtual_notify(int *notified);
+
+#endif
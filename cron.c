@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include <stdlib.h>
+#include <pthread.h>
+#include "cron.h"
+#include "hash.h"
 
 int match_cron_field(const char *field, int value, int min, int max) {
     if (strcmp(field, "*") == 0) return 1;
@@ -45,3 +47,531 @@ int match_cron_field(const char *field, int value, int min, int max) {
     free(copy);
     return match_found;
 }
+
+// Reads a non-negative decimal number, advancing *p past it
+static int parse_cron_number(const char **p, const char *end, int *out) {
+    const char *s = *p;
+    int value = 0;
+
+    if (s >= end || !isdigit((unsigned char)*s)) return -1;
+    while (s < end && isdigit((unsigned char)*s)) {
+        value = value * 10 + (*s - '0');
+        if (value > 1000) return -1;
+        s++;
+    }
+
+    *out = value;
+    *p = s;
+    return 0;
+}
+
+// Compiles one comma separated field ("*", "a", "a-b", "*/s", "a/s", "a-b/s")
+// into a bitmask where bit N is set when value N matches
+static int compile_cron_field(const char *field, const char *end, int min, int max, uint64_t *mask) {
+    *mask = 0;
+
+    while (field < end) {
+        const char *token_end = memchr(field, ',', end - field);
+        if (!token_end) token_end = end;
+
+        const char *p = field;
+        int start = min, stop = max, step = 1;
+
+        if (*p == '*') {
+            p++;
+        } else {
+            if (parse_cron_number(&p, token_end, &start) != 0) return -1;
+            stop = start;
+            if (p < token_end && *p == '-') {
+                p++;
+                if (parse_cron_number(&p, token_end, &stop) != 0) return -1;
+            }
+        }
+
+        if (p < token_end && *p == '/') {
+            p++;
+            if (parse_cron_number(&p, token_end, &step) != 0 || step == 0) return -1;
+            // "a/s" runs from a to the end of the field range
+            if (field[0] != '*' && memchr(field, '-', p - field) == NULL) stop = max;
+        }
+
+        if (p != token_end) return -1;
+        if (start < min || stop > max || start > stop) return -1;
+
+        for (int value = start; value <= stop; value += step) {
+            *mask |= 1ULL << value;
+        }
+
+        // A comma ending the field leaves an empty token, like ",1" and "1,,2"
+        if (token_end + 1 == end) return -1;
+        field = token_end + 1;
+    }
+
+    return *mask ? 0 : -1;
+}
+
+// Seconds, minutes, hours, days of month, months, days of week
+static const int field_min[6] = {0, 0, 0, 1, 1, 0};
+static const int field_max[6] = {59, 59, 23, 31, 12, 6};
+
+int cron_compile(const char *expression, CronSchedule *schedule) {
+    const char *field_start[6];
+    const char *field_end[6];
+    uint64_t masks[6];
+    int field_count = 0;
+
+    memset(schedule, 0, sizeof(CronSchedule));
+    if (!expression) return -1;
+
+    const char *p = expression;
+    while (*p) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+        if (field_count >= 6) return -1;
+
+        field_start[field_count] = p;
+        while (*p && !isspace((unsigned char)*p)) p++;
+        field_end[field_count] = p;
+        field_count++;
+    }
+
+    if (field_count != 5 && field_count != 6) return -1;
+
+    // Without a seconds field every range shifts by one and second 0 is implied
+    int first = 6 - field_count;
+    masks[0] = 1;
+    for (int i = 0; i < field_count; i++) {
+        int field = first + i;
+        if (compile_cron_field(field_start[i], field_end[i], field_min[field], field_max[field], &masks[field]) != 0) {
+            return -1;
+        }
+    }
+
+    schedule->seconds = masks[0];
+    schedule->minutes = masks[1];
+    schedule->hours = (uint32_t)masks[2];
+    schedule->days_of_month = (uint32_t)masks[3];
+    schedule->months = (uint16_t)masks[4];
+    schedule->days_of_week = (uint8_t)masks[5];
+    schedule->valid = 1;
+    return 0;
+}
+
+// Trims the expression and collapses whitespace runs into single spaces
+static void cron_normalize(const char *expression, char *out, size_t size) {
+    size_t length = 0;
+    int pending_space = 0;
+
+    for (const char *p = expression; *p && length + 2 < size; p++) {
+        if (isspace((unsigned char)*p)) {
+            pending_space = length > 0;
+            continue;
+        }
+        if (pending_space) out[length++] = ' ';
+        out[length++] = *p;
+        pending_space = 0;
+    }
+    out[length] = '\0';
+}
+
+// Appends a formatted piece to out, failing when it doesn't fit
+static int cron_append(char *out, size_t size, size_t *length, const char *format, int a, int b, int c) {
+    int written = snprintf(out + *length, size - *length, format, a, b, c);
+    if (written < 0 || (size_t)written >= size - *length) return -1;
+    *length += written;
+    return 0;
+}
+
+// Rewrites one "H", "H/n", "H(a-b)" or "H(a-b)/n" token as plain cron syntax
+static int cron_resolve_token(const char *token, const char *end, int field, unsigned long hash,
+                              char *out, size_t size, size_t *length) {
+    // Like Jenkins, hashed days of month stay within 1-28 so every month gets a run
+    int start = field_min[field];
+    int stop = (field == 3) ? 28 : field_max[field];
+    int explicit_range = 0;
+    int step = 0;
+    const char *p = token + 1;
+
+    if (p < end && *p == '(') {
+        p++;
+        if (parse_cron_number(&p, end, &start) != 0 || p >= end || *p++ != '-' ||
+            parse_cron_number(&p, end, &stop) != 0 || p >= end || *p++ != ')') {
+            return -1;
+        }
+        if (start < field_min[field] || stop > field_max[field] || start > stop) return -1;
+        explicit_range = 1;
+    }
+    if (p < end && *p == '/') {
+        p++;
+        if (parse_cron_number(&p, end, &step) != 0 || step == 0) return -1;
+    }
+    if (p != end) return -1;
+
+    int span = stop - start + 1;
+    if (step == 0) {
+        return cron_append(out, size, length, "%d", start + (int)(hash % span), 0, 0);
+    }
+
+    int first = start + (int)(hash % (step < span ? step : span));
+    if (!explicit_range && field != 3) {
+        return cron_append(out, size, length, "%d/%d", first, step, 0);
+    }
+    return cron_append(out, size, length, "%d-%d/%d", first, stop, step);
+}
+
+// Expands Jenkins style hash tokens so DAGs sharing "H * * * *" spread over
+// the hour instead of all starting at :00. Each H picks a value (or, with a
+// step, an offset) that is stable for a given seed, usually the DAG name.
+// Writes the normalized expression with every H replaced; other tokens are
+// copied untouched and left for cron_compile to validate.
+int cron_resolve_hashed(const char *expression, const char *seed, char *out, size_t size) {
+    char normalized[256];
+    cron_normalize(expression ? expression : "", normalized, sizeof(normalized));
+
+    int field_count = 1;
+    for (const char *p = normalized; *p; p++) {
+        if (*p == ' ') field_count++;
+    }
+    if (field_count != 5 && field_count != 6) return -1;
+
+    unsigned long seed_hash = hashString(seed ? seed : "");
+    int field = 6 - field_count;
+    int token_index = 0;
+    size_t length = 0;
+    const char *p = normalized;
+    out[0] = '\0';
+
+    while (*p) {
+        const char *token_end = p;
+        while (*token_end && *token_end != ' ' && *token_end != ',') token_end++;
+
+        if (*p == 'H') {
+            unsigned long hash = hashMix(seed_hash + (unsigned long)(field * 8 + token_index) * 0x9e3779b97f4a7c15UL);
+            if (cron_resolve_token(p, token_end, field, hash, out, size, &length) != 0) return -1;
+        } else {
+            if ((size_t)(token_end - p) >= size - length) return -1;
+            memcpy(out + length, p, token_end - p);
+            length += token_end - p;
+            out[length] = '\0';
+        }
+
+        if (*token_end == ',') {
+            token_index++;
+        } else if (*token_end == ' ') {
+            field++;
+            token_index = 0;
+        }
+        if (*token_end) {
+            if (length + 1 >= size) return -1;
+            out[length++] = *token_end;
+            out[length] = '\0';
+            token_end++;
+        }
+        p = token_end;
+    }
+
+    return 0;
+}
+
+int cron_compile_seeded(const char *expression, const char *seed, CronSchedule *schedule) {
+    char resolved[256];
+    if (cron_resolve_hashed(expression, seed, resolved, sizeof(resolved)) != 0) {
+        memset(schedule, 0, sizeof(CronSchedule));
+        return -1;
+    }
+    return cron_compile(resolved, schedule);
+}
+
+int cron_matches(const CronSchedule *schedule, struct CronTime now) {
+    return schedule->valid &&
+           (schedule->seconds >> now.second & 1) &&
+           (schedule->minutes >> now.minute & 1) &&
+           (schedule->hours >> now.hour & 1) &&
+           (schedule->days_of_month >> now.day_of_month & 1) &&
+           (schedule->months >> now.month & 1) &&
+           (schedule->days_of_week >> now.day_of_week & 1);
+}
+
+// Fires within each matching minute, 1 for classic 5-field expressions
+int cron_fires_per_minute(const CronSchedule *schedule) {
+    return __builtin_popcountll(schedule->seconds);
+}
+
+struct CronTime cron_time_at(time_t when) {
+    struct tm local;
+    localtime_r(&when, &local);
+
+    struct CronTime cron_time = {
+        local.tm_sec,
+        local.tm_min,
+        local.tm_hour,
+        local.tm_mday,
+        local.tm_mon + 1,  // tm_mon is 0-11, CronTime expects 1-12
+        local.tm_wday      // 0-6, Sunday = 0
+    };
+    return cron_time;
+}
+
+static int cron_is_leap_year(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int cron_days_in_month(int year, int month) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return (month == 2 && cron_is_leap_year(year)) ? 29 : days[month - 1];
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static long cron_days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long year_of_era = year - era * 400;
+    long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// Converts a local wall clock minute to time_t using a UTC offset hint, and
+// retries with the offset in effect at the guess when DST changed in between.
+// Returns -1 for wall clock times that don't exist (skipped by a DST jump).
+static time_t cron_local_to_time(int year, int month, int day, int hour, int minute, long *gmtoff) {
+    time_t wall = (time_t)cron_days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        time_t guess = wall - *gmtoff;
+        struct tm local;
+        localtime_r(&guess, &local);
+
+        if (local.tm_year + 1900 == year && local.tm_mon + 1 == month && local.tm_mday == day &&
+            local.tm_hour == hour && local.tm_min == minute) {
+            return guess;
+        }
+        if (local.tm_gmtoff == *gmtoff) break;
+        *gmtoff = local.tm_gmtoff;
+    }
+    return -1;
+}
+
+// Returns the first second strictly after `after` that matches the schedule,
+// or -1 when nothing matches within CRON_SEARCH_YEARS (e.g. "0 0 30 2 *").
+// Walks local calendar fields arithmetically, only touching the timezone
+// database to turn a matching minute back into a time_t.
+time_t cron_next_fire(const CronSchedule *schedule, time_t after) {
+    if (!schedule->valid) return -1;
+
+    // Start from the next real second, with its offset, so a start inside
+    // the repeated hour at the end of DST walks the pass it is in
+    time_t start = after + 1;
+    struct tm tm;
+    localtime_r(&start, &tm);
+
+    long gmtoff = tm.tm_gmtoff;
+    int year = tm.tm_year + 1900;
+    int month = tm.tm_mon + 1;
+    int day = tm.tm_mday;
+    int hour = tm.tm_hour;
+    int minute = tm.tm_min;
+    int second = tm.tm_sec > 59 ? 59 : tm.tm_sec;
+    int weekday = tm.tm_wday;
+    int last_year = year + CRON_SEARCH_YEARS;
+    int repeating = 0;  // walking the hour a second time after the clock fell back
+
+    while (year <= last_year) {
+        if (!(schedule->months >> month & 1)) {
+            weekday = (weekday + cron_days_in_month(year, month) - day + 1) % 7;
+            day = 1;
+            hour = 0;
+            minute = 0;
+            second = 0;
+            if (++month > 12) {
+                month = 1;
+                year++;
+            }
+            continue;
+        }
+
+        if (!(schedule->days_of_month >> day & 1) || !(schedule->days_of_week >> weekday & 1)) {
+            weekday = (weekday + 1) % 7;
+            hour = 0;
+            minute = 0;
+            second = 0;
+            if (++day > cron_days_in_month(year, month)) {
+                day = 1;
+                if (++month > 12) {
+                    month = 1;
+                    year++;
+                }
+            }
+            continue;
+        }
+
+        uint32_t hours_left = schedule->hours >> hour << hour;
+        if (hours_left) {
+            int next_hour = __builtin_ctz(hours_left);
+            if (next_hour != hour) {
+                hour = next_hour;
+                minute = 0;
+                second = 0;
+            }
+
+            uint64_t minutes_left = schedule->minutes >> minute << minute;
+            while (minutes_left) {
+                int next_minute = __builtin_ctzll(minutes_left);
+                if (next_minute != minute) {
+                    minute = next_minute;
+                    second = 0;
+                }
+
+                uint64_t seconds_left = schedule->seconds >> second << second;
+                if (seconds_left) {
+                    // -1 when DST skipped this minute
+                    time_t minute_start = cron_local_to_time(year, month, day, hour, minute, &gmtoff);
+                    time_t candidate = minute_start + __builtin_ctzll(seconds_left);
+                    if (minute_start != -1 && candidate > after) return candidate;
+                }
+
+                minutes_left &= minutes_left - 1;
+                second = 0;
+            }
+
+            // When the clock falls back at the end of this hour, the part it
+            // repeats (all of it, or the last half hour in some zones) is
+            // walked once more with the offset after the change
+            if (!repeating) {
+                time_t hour_end = (time_t)cron_days_from_civil(year, month, day) * 86400 + (hour + 1) * 3600 - gmtoff;
+                struct tm next;
+                localtime_r(&hour_end, &next);
+                if (next.tm_hour == hour && next.tm_gmtoff != gmtoff) {
+                    gmtoff = next.tm_gmtoff;
+                    repeating = 1;
+                    minute = next.tm_min;
+                    second = next.tm_sec > 59 ? 59 : next.tm_sec;
+                    continue;
+                }
+            }
+        } else {
+            // Nothing left today, let the hour step roll over into tomorrow
+            hour = 23;
+        }
+
+        // Move to the next hour, rolling over into the next day
+        repeating = 0;
+        minute = 0;
+        second = 0;
+        if (++hour > 23) {
+            hour = 0;
+            weekday = (weekday + 1) % 7;
+            if (++day > cron_days_in_month(year, month)) {
+                day = 1;
+                if (++month > 12) {
+                    month = 1;
+                    year++;
+                }
+            }
+        }
+    }
+
+    return -1;
+}
+
+// Interned schedules, chained by hash of the normalized expression
+typedef struct CronInternEntry {
+    CronSchedule schedule;  // first, so a schedule pointer is its entry
+    int refcount;
+    unsigned long hash;
+    struct CronInternEntry *next;
+    char expression[];
+} CronInternEntry;
+
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+static CronInternEntry **intern_buckets = NULL;
+static int intern_bucket_count = 0;
+static int intern_count = 0;
+
+static int cron_intern_grow(void) {
+    int bucket_count = intern_bucket_count ? intern_bucket_count * 2 : 64;
+    CronInternEntry **buckets = calloc(bucket_count, sizeof(CronInternEntry*));
+    if (!buckets) return -1;
+
+    for (int i = 0; i < intern_bucket_count; i++) {
+        CronInternEntry *entry = intern_buckets[i];
+        while (entry) {
+            CronInternEntry *next = entry->next;
+            CronInternEntry **bucket = &buckets[entry->hash % bucket_count];
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+
+    free(intern_buckets);
+    intern_buckets = buckets;
+    intern_bucket_count = bucket_count;
+    return 0;
+}
+
+const CronSchedule* cron_intern(const char *expression) {
+    char normalized[256];
+    cron_normalize(expression ? expression : "", normalized, sizeof(normalized));
+    unsigned long hash = hashString(normalized);
+
+    pthread_mutex_lock(&intern_mutex);
+
+    if (intern_bucket_count) {
+        for (CronInternEntry *entry = intern_buckets[hash % intern_bucket_count]; entry; entry = entry->next) {
+            if (entry->hash == hash && strcmp(entry->expression, normalized) == 0) {
+                entry->refcount++;
+                pthread_mutex_unlock(&intern_mutex);
+                return &entry->schedule;
+            }
+        }
+    }
+
+    if (intern_count >= intern_bucket_count && cron_intern_grow() != 0 && intern_bucket_count == 0) {
+        pthread_mutex_unlock(&intern_mutex);
+        return NULL;
+    }
+
+    size_t length = strlen(normalized);
+    CronInternEntry *entry = malloc(sizeof(CronInternEntry) + length + 1);
+    if (!entry) {
+        pthread_mutex_unlock(&intern_mutex);
+        return NULL;
+    }
+
+    memcpy(entry->expression, normalized, length + 1);
+    cron_compile(entry->expression, &entry->schedule);
+    entry->schedule.expression = entry->expression;
+    entry->refcount = 1;
+    entry->hash = hash;
+
+    CronInternEntry **bucket = &intern_buckets[hash % intern_bucket_count];
+    entry->next = *bucket;
+    *bucket = entry;
+    intern_count++;
+
+    pthread_mutex_unlock(&intern_mutex);
+    return &entry->schedule;
+}
+
+void cron_release(const CronSchedule *schedule) {
+    if (!schedule) return;
+    CronInternEntry *entry = (CronInternEntry*)schedule;
+
+    pthread_mutex_lock(&intern_mutex);
+    if (--entry->refcount == 0) {
+        CronInternEntry **link = &intern_buckets[entry->hash % intern_bucket_count];
+        while (*link != entry) link = &(*link)->next;
+        *link = entry->next;
+        intern_count--;
+        free(entry);
+    }
+    pthread_mutex_unlock(&intern_mutex);
+}
+
+int cron_interned_count(void) {
+    pthread_mutex_lock(&intern_mutex);
+    int count = intern_count;
+    pthread_mutex_unlock(&intern_mutex);
+    return count;
+}
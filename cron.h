@@ -1,7 +1,15 @@
 #ifndef CONDUIT_CRON_H
 #define CONDUIT_CRON_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// How far ahead cron_next_fire looks before giving up on a schedule
+#define CRON_SEARCH_YEARS 30
+
 struct CronTime {
+    int second;
     int minute;
     int hour;
     int day_of_month;
@@ -9,6 +17,36 @@ struct CronTime {
     int day_of_week;
 };
 
+// Compiled cron expression: one bit per allowed value of each field.
+// Built once by cron_compile so matching a tick is a handful of ANDs.
+// Expressions take an optional leading seconds field ("*/5 * * * * *"),
+// the classic 5-field form fires at second 0.
+typedef struct CronSchedule {
+    uint64_t seconds;        // bits 0-59
+    uint64_t minutes;        // bits 0-59
+    uint32_t hours;          // bits 0-23
+    uint32_t days_of_month;  // bits 1-31
+    uint16_t months;         // bits 1-12
+    uint8_t days_of_week;    // bits 0-6, Sunday = 0
+    uint8_t valid;
+    const char *expression;  // normalized source text, only set on interned schedules
+} CronSchedule;
+
 int match_cron_field(const char *field, int value, int min, int max);
+int cron_compile(const char *expression, CronSchedule *schedule);
+// "H" tokens (H, H/n, H(a-b), H(a-b)/n) resolve to stable values derived from seed
+int cron_resolve_hashed(const char *expression, const char *seed, char *out, size_t size);
+int cron_compile_seeded(const char *expression, const char *seed, CronSchedule *schedule);
+int cron_matches(const CronSchedule *schedule, struct CronTime now);
+struct CronTime cron_time_at(time_t when);
+time_t cron_next_fire(const CronSchedule *schedule, time_t after);
+int cron_fires_per_minute(const CronSchedule *schedule);
+
+// Shared schedules: every caller interning the same expression (modulo
+// whitespace) gets the same reference counted object. Invalid expressions are
+// interned too, with valid = 0, so their text is still available.
+const CronSchedule* cron_intern(const char *expression);
+void cron_release(const CronSchedule *schedule);
+int cron_interned_count(void);
 
 #endif
@@ -0,0 +1,275 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cron_table.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRON_TABLE_X86
+#endif
+
+// One instant broadcast against every row: the bit each column must have set
+typedef struct CronProbe {
+    uint64_t second;
+    uint64_t minute;
+    uint32_t hour;
+    uint32_t day_of_month;
+    uint32_t calendar;        // month and weekday bits, both required
+} CronProbe;
+
+typedef void (*CronTableKernelFn)(const CronTable *table, const CronProbe *probe, int words, uint64_t *due);
+
+static CronTableKernel active_kernel = CRON_KERNEL_AUTO;
+
+static uint32_t cron_table_calendar(uint16_t months, uint8_t days_of_week) {
+    return (uint32_t)months | (uint32_t)days_of_week << 16;
+}
+
+void cron_table_init(CronTable *table) {
+    memset(table, 0, sizeof(CronTable));
+}
+
+void cron_table_free(CronTable *table) {
+    free(table->seconds);
+    free(table->minutes);
+    free(table->hours);
+    free(table->days_of_month);
+    free(table->calendar);
+    cron_table_init(table);
+}
+
+static int cron_table_grow_column(void **column, size_t width, int old_capacity, int capacity) {
+    void *grown = realloc(*column, capacity * width);
+    if (!grown) return -1;
+    memset((char*)grown + old_capacity * width, 0, (capacity - old_capacity) * width);
+    *column = grown;
+    return 0;
+}
+
+static int cron_table_grow(CronTable *table) {
+    int capacity = table->capacity ? table->capacity * 2 : 64;
+    if (cron_table_grow_column((void**)&table->seconds, sizeof(uint64_t), table->capacity, capacity) != 0 ||
+        cron_table_grow_column((void**)&table->minutes, sizeof(uint64_t), table->capacity, capacity) != 0 ||
+        cron_table_grow_column((void**)&table->hours, sizeof(uint32_t), table->capacity, capacity) != 0 ||
+        cron_table_grow_column((void**)&table->days_of_month, sizeof(uint32_t), table->capacity, capacity) != 0 ||
+        cron_table_grow_column((void**)&table->calendar, sizeof(uint32_t), table->capacity, capacity) != 0) {
+        // Columns that did grow keep working at the old capacity
+        return -1;
+    }
+    table->capacity = capacity;
+    return 0;
+}
+
+void cron_table_set(CronTable *table, int row, const CronSchedule *schedule) {
+    // Invalid schedules are stored empty so they never match
+    int valid = schedule && schedule->valid;
+    table->seconds[row] = valid ? schedule->seconds : 0;
+    table->minutes[row] = valid ? schedule->minutes : 0;
+    table->hours[row] = valid ? schedule->hours : 0;
+    table->days_of_month[row] = valid ? schedule->days_of_month : 0;
+    table->calendar[row] = valid ? cron_table_calendar(schedule->months, schedule->days_of_week) : 0;
+}
+
+int cron_table_append(CronTable *table, const CronSchedule *schedule) {
+    if (table->count == table->capacity && cron_table_grow(table) != 0) return -1;
+    int row = table->count++;
+    cron_table_set(table, row, schedule);
+    return row;
+}
+
+int cron_table_remove(CronTable *table, int row) {
+    int last = --table->count;
+    int moved = -1;
+    if (row != last) {
+        table->seconds[row] = table->seconds[last];
+        table->minutes[row] = table->minutes[last];
+        table->hours[row] = table->hours[last];
+        table->days_of_month[row] = table->days_of_month[last];
+        table->calendar[row] = table->calendar[last];
+        moved = last;
+    }
+    cron_table_set(table, last, NULL);
+    return moved;
+}
+
+static void cron_table_due_scalar(const CronTable *table, const CronProbe *probe, int words, uint64_t *due) {
+    for (int word = 0; word < words; word++) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 64; i++) {
+            int row = word * 64 + i;
+            uint64_t hit = (table->seconds[row] & probe->second) != 0 &&
+                           (table->minutes[row] & probe->minute) != 0 &&
+                           (table->hours[row] & probe->hour) != 0 &&
+                           (table->days_of_month[row] & probe->day_of_month) != 0 &&
+                           (table->calendar[row] & probe->calendar) == probe->calendar;
+            bits |= hit << i;
+        }
+        due[word] = bits;
+    }
+}
+
+#ifdef CRON_TABLE_X86
+// SSE2 has no 64-bit compare: a 64-bit lane is zero when both its halves are
+__attribute__((target("sse2")))
+static inline __m128i cron_zero_epi64(__m128i value) {
+    __m128i zero = _mm_cmpeq_epi32(value, _mm_setzero_si128());
+    return _mm_and_si128(zero, _mm_shuffle_epi32(zero, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("sse2")))
+static void cron_table_due_sse2(const CronTable *table, const CronProbe *probe, int words, uint64_t *due) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i second = _mm_set1_epi64x(probe->second);
+    const __m128i minute = _mm_set1_epi64x(probe->minute);
+    const __m128i hour = _mm_set1_epi32(probe->hour);
+    const __m128i day = _mm_set1_epi32(probe->day_of_month);
+    const __m128i calendar = _mm_set1_epi32(probe->calendar);
+
+    for (int word = 0; word < words; word++) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 64; i += 4) {
+            int row = word * 64 + i;
+            __m128i h = _mm_loadu_si128((const __m128i*)(table->hours + row));
+            __m128i d = _mm_loadu_si128((const __m128i*)(table->days_of_month + row));
+            __m128i c = _mm_loadu_si128((const __m128i*)(table->calendar + row));
+            __m128i miss = _mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(h, hour), zero),
+                                        _mm_cmpeq_epi32(_mm_and_si128(d, day), zero));
+            __m128i hit = _mm_andnot_si128(miss, _mm_cmpeq_epi32(_mm_and_si128(c, calendar), calendar));
+
+            __m128i s_low = _mm_loadu_si128((const __m128i*)(table->seconds + row));
+            __m128i s_high = _mm_loadu_si128((const __m128i*)(table->seconds + row + 2));
+            __m128i m_low = _mm_loadu_si128((const __m128i*)(table->minutes + row));
+            __m128i m_high = _mm_loadu_si128((const __m128i*)(table->minutes + row + 2));
+            __m128i miss_low = _mm_or_si128(cron_zero_epi64(_mm_and_si128(s_low, second)),
+                                            cron_zero_epi64(_mm_and_si128(m_low, minute)));
+            __m128i miss_high = _mm_or_si128(cron_zero_epi64(_mm_and_si128(s_high, second)),
+                                             cron_zero_epi64(_mm_and_si128(m_high, minute)));
+
+            unsigned lanes = _mm_movemask_ps(_mm_castsi128_ps(hit)) &
+                             ~(_mm_movemask_pd(_mm_castsi128_pd(miss_low)) |
+                               _mm_movemask_pd(_mm_castsi128_pd(miss_high)) << 2);
+            bits |= (uint64_t)(lanes & 0xf) << i;
+        }
+        due[word] = bits;
+    }
+}
+
+__attribute__((target("avx2")))
+static void cron_table_due_avx2(const CronTable *table, const CronProbe *probe, int words, uint64_t *due) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i second = _mm256_set1_epi64x(probe->second);
+    const __m256i minute = _mm256_set1_epi64x(probe->minute);
+    const __m256i hour = _mm256_set1_epi32(probe->hour);
+    const __m256i day = _mm256_set1_epi32(probe->day_of_month);
+    const __m256i calendar = _mm256_set1_epi32(probe->calendar);
+
+    for (int word = 0; word < words; word++) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 64; i += 8) {
+            int row = word * 64 + i;
+            __m256i h = _mm256_loadu_si256((const __m256i*)(table->hours + row));
+            __m256i d = _mm256_loadu_si256((const __m256i*)(table->days_of_month + row));
+            __m256i c = _mm256_loadu_si256((const __m256i*)(table->calendar + row));
+            __m256i miss = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(h, hour), zero),
+                                           _mm256_cmpeq_epi32(_mm256_and_si256(d, day), zero));
+            __m256i hit = _mm256_andnot_si256(miss, _mm256_cmpeq_epi32(_mm256_and_si256(c, calendar), calendar));
+
+            __m256i s_low = _mm256_loadu_si256((const __m256i*)(table->seconds + row));
+            __m256i s_high = _mm256_loadu_si256((const __m256i*)(table->seconds + row + 4));
+            __m256i m_low = _mm256_loadu_si256((const __m256i*)(table->minutes + row));
+            __m256i m_high = _mm256_loadu_si256((const __m256i*)(table->minutes + row + 4));
+            __m256i miss_low = _mm256_or_si256(_mm256_cmpeq_epi64(_mm256_and_si256(s_low, second), zero),
+                                               _mm256_cmpeq_epi64(_mm256_and_si256(m_low, minute), zero));
+            __m256i miss_high = _mm256_or_si256(_mm256_cmpeq_epi64(_mm256_and_si256(s_high, second), zero),
+                                                _mm256_cmpeq_epi64(_mm256_and_si256(m_high, minute), zero));
+
+            unsigned lanes = _mm256_movemask_ps(_mm256_castsi256_ps(hit)) &
+                             ~(_mm256_movemask_pd(_mm256_castsi256_pd(miss_low)) |
+                               _mm256_movemask_pd(_mm256_castsi256_pd(miss_high)) << 4);
+            bits |= (uint64_t)(lanes & 0xff) << i;
+        }
+        due[word] = bits;
+    }
+}
+#endif
+
+static int cron_table_supports(CronTableKernel kernel) {
+    switch (kernel) {
+    case CRON_KERNEL_SCALAR:
+        return 1;
+#ifdef CRON_TABLE_X86
+    case CRON_KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case CRON_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+int cron_table_use_kernel(CronTableKernel kernel) {
+    if (kernel == CRON_KERNEL_AUTO) {
+        kernel = CRON_KERNEL_SCALAR;
+        if (cron_table_supports(CRON_KERNEL_SSE2)) kernel = CRON_KERNEL_SSE2;
+        if (cron_table_supports(CRON_KERNEL_AVX2)) kernel = CRON_KERNEL_AVX2;
+    }
+    if (!cron_table_supports(kernel)) return -1;
+    active_kernel = kernel;
+    return 0;
+}
+
+CronTableKernel cron_table_kernel(void) {
+    if (active_kernel == CRON_KERNEL_AUTO) cron_table_use_kernel(CRON_KERNEL_AUTO);
+    return active_kernel;
+}
+
+const char* cron_table_kernel_name(CronTableKernel kernel) {
+    switch (kernel) {
+    case CRON_KERNEL_SCALAR: return "scalar";
+    case CRON_KERNEL_SSE2: return "sse2";
+    case CRON_KERNEL_AVX2: return "avx2";
+    default: return "auto";
+    }
+}
+
+static int cron_table_evaluate(const CronTable *table, const CronProbe *probe, uint64_t *due) {
+    int words = CRON_TABLE_WORDS(table->count);
+    CronTableKernelFn kernel = cron_table_due_scalar;
+#ifdef CRON_TABLE_X86
+    switch (cron_table_kernel()) {
+    case CRON_KERNEL_SSE2: kernel = cron_table_due_sse2; break;
+    case CRON_KERNEL_AVX2: kernel = cron_table_due_avx2; break;
+    default: break;
+    }
+#endif
+    kernel(table, probe, words, due);
+
+    int due_count = 0;
+    for (int word = 0; word < words; word++) {
+        due_count += __builtin_popcountll(due[word]);
+    }
+    return due_count;
+}
+
+static CronProbe cron_table_probe(struct CronTime now) {
+    CronProbe probe = {
+        1ULL << now.second,
+        1ULL << now.minute,
+        1U << now.hour,
+        1U << now.day_of_month,
+        cron_table_calendar(1U << now.month, 1U << now.day_of_week)
+    };
+    return probe;
+}
+
+int cron_table_due(const CronTable *table, struct CronTime now, uint64_t *due) {
+    CronProbe probe = cron_table_probe(now);
+    return cron_table_evaluate(table, &probe, due);
+}
+
+int cron_table_due_in_hour(const CronTable *table, struct CronTime now, uint64_t *due) {
+    CronProbe probe = cron_table_probe(now);
+    probe.second = ~0ULL;
+    probe.minute = ~0ULL;
+    return cron_table_evaluate(table, &probe, due);
+}
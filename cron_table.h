@@ -0,0 +1,52 @@
+#ifndef CONDUIT_CRON_TABLE_H
+#define CONDUIT_CRON_TABLE_H
+
+#include <stdint.h>
+#include "cron.h"
+
+// Compiled schedules stored column by column, one array per field, so "which
+// schedules are due at this instant" is answered for the whole catalog in one
+// pass over the columns instead of one cron_matches call per schedule. The
+// answer is a bitmap, bit N of word N / 64 set when row N is due.
+// Rows are kept padded to a multiple of 64 with empty masks, which never match.
+#define CRON_TABLE_WORDS(count) (((count) + 63) / 64)
+
+typedef struct CronTable {
+    int count;
+    int capacity;
+    uint64_t *seconds;
+    uint64_t *minutes;
+    uint32_t *hours;
+    uint32_t *days_of_month;
+    uint32_t *calendar;       // months in bits 1-12, days of week in bits 16-22
+} CronTable;
+
+// Evaluation kernels; AUTO picks the widest one the CPU supports
+typedef enum {
+    CRON_KERNEL_AUTO,
+    CRON_KERNEL_SCALAR,
+    CRON_KERNEL_SSE2,
+    CRON_KERNEL_AVX2
+} CronTableKernel;
+
+void cron_table_init(CronTable *table);
+void cron_table_free(CronTable *table);
+// Returns the new row, -1 when out of memory
+int cron_table_append(CronTable *table, const CronSchedule *schedule);
+void cron_table_set(CronTable *table, int row, const CronSchedule *schedule);
+// Fills the hole with the last row. Returns the old index of the row that
+// moved into row, -1 when row was the last one.
+int cron_table_remove(CronTable *table, int row);
+
+// due receives CRON_TABLE_WORDS(count) words, the return value is the number
+// of rows due. The _in_hour variant ignores the minute and second fields,
+// the rows it returns fire somewhere within that hour.
+int cron_table_due(const CronTable *table, struct CronTime now, uint64_t *due);
+int cron_table_due_in_hour(const CronTable *table, struct CronTime now, uint64_t *due);
+
+// Returns -1 when the CPU lacks the requested kernel
+int cron_table_use_kernel(CronTableKernel kernel);
+CronTableKernel cron_table_kernel(void);
+const char* cron_table_kernel_name(CronTableKernel kernel);
+
+#endif
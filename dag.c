@@ -1,9 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <time.h>
+#include <pthread.h>
 #include "dag.h"
 #include "logger.h"
+#include "clock_source.h"
 
 // Utility Functions Implementation
 
@@ -15,6 +18,7 @@ const char* execution_status_to_string(ExecutionStatus status) {
         case EXECUTION_STATUS_FAILED: return "failed";
         case EXECUTION_STATUS_CANCELLED: return "cancelled";
         case EXECUTION_STATUS_SKIPPED: return "skipped";
+        case EXECUTION_STATUS_CACHED: return "cached";
         default: return "unknown";
     }
 }
@@ -26,6 +30,7 @@ ExecutionStatus string_to_execution_status(const char *status) {
     if (strcmp(status, "failed") == 0) return EXECUTION_STATUS_FAILED;
     if (strcmp(status, "cancelled") == 0) return EXECUTION_STATUS_CANCELLED;
     if (strcmp(status, "skipped") == 0) return EXECUTION_STATUS_SKIPPED;
+    if (strcmp(status, "cached") == 0) return EXECUTION_STATUS_CACHED;
     return EXECUTION_STATUS_PENDING;
 }
 
@@ -45,6 +50,40 @@ DAGStatus string_to_dag_status(const char *status) {
     return DAG_STATUS_ACTIVE;
 }
 
+const char* overlap_policy_to_string(OverlapPolicy policy) {
+    switch (policy) {
+        case OVERLAP_POLICY_QUEUE: return "queue";
+        case OVERLAP_POLICY_SKIP: return "skip";
+        case OVERLAP_POLICY_CANCEL_PREVIOUS: return "cancel_previous";
+        default: return "queue";
+    }
+}
+
+int string_to_overlap_policy(const char *policy) {
+    if (strcmp(policy, "queue") == 0) return OVERLAP_POLICY_QUEUE;
+    if (strcmp(policy, "skip") == 0) return OVERLAP_POLICY_SKIP;
+    if (strcmp(policy, "cancel_previous") == 0) return OVERLAP_POLICY_CANCEL_PREVIOUS;
+    return -1;
+}
+
+const char* trigger_rule_to_string(TriggerRule rule) {
+    switch (rule) {
+        case TRIGGER_RULE_ALL_SUCCESS: return "all_success";
+        case TRIGGER_RULE_ALL_DONE: return "all_done";
+        case TRIGGER_RULE_ONE_FAILED: return "one_failed";
+        case TRIGGER_RULE_NONE_FAILED: return "none_failed";
+        default: return "all_success";
+    }
+}
+
+int string_to_trigger_rule(const char *rule) {
+    if (strcmp(rule, "all_success") == 0) return TRIGGER_RULE_ALL_SUCCESS;
+    if (strcmp(rule, "all_done") == 0) return TRIGGER_RULE_ALL_DONE;
+    if (strcmp(rule, "one_failed") == 0) return TRIGGER_RULE_ONE_FAILED;
+    if (strcmp(rule, "none_failed") == 0) return TRIGGER_RULE_NONE_FAILED;
+    return -1;
+}
+
 // DAG Management Functions
 
 DAG* create_dag(const char *name, const char *cron_expression, const char *description) {
@@ -56,12 +95,19 @@ DAG* create_dag(const char *name, const char *cron_expression, const char *descr
     
     memset(dag, 0, sizeof(DAG));
     strncpy(dag->name, name, MAX_DAG_NAME_LENGTH - 1);
-    strncpy(dag->cron_expression, cron_expression, MAX_CRON_EXPRESSION_LENGTH - 1);
+    if (dag_set_schedule(dag, cron_expression) != 0) {
+        log_message("Failed to allocate schedule for DAG %s\n", dag->name);
+        free(dag);
+        return NULL;
+    }
+    if (!dag->schedule->valid) {
+        log_message("Invalid cron expression '%s' for DAG %s\n", dag->cron_expression, dag->name);
+    }
     strncpy(dag->description, description ? description : "", MAX_DESCRIPTION_LENGTH - 1);
     
     dag->status = DAG_STATUS_ACTIVE;
-    dag->created_at = time(NULL);
-    dag->updated_at = time(NULL);
+    dag->created_at = clock_now();
+    dag->updated_at = clock_now();
     dag->tasks = NULL;
     dag->task_count = 0;
     dag->next = NULL;
@@ -69,6 +115,34 @@ DAG* create_dag(const char *name, const char *cron_expression, const char *descr
     return dag;
 }
 
+// Points the DAG at the shared schedule of its expression, with H tokens
+// resolved against the DAG name (set the name first). cron_expression keeps
+// the text as written: the schedule's own text, or a private copy when H
+// tokens made the two differ.
+int dag_set_schedule(DAG *dag, const char *cron_expression) {
+    char resolved[256];
+    if (cron_resolve_hashed(cron_expression, dag->name, resolved, sizeof(resolved)) != 0) {
+        // Interned as written and left invalid, like any other bad expression
+        snprintf(resolved, sizeof(resolved), "%s", cron_expression ? cron_expression : "");
+    }
+
+    const CronSchedule *schedule = cron_intern(resolved);
+    if (!schedule) return -1;
+
+    const char *text = schedule->expression;
+    if (cron_expression && strchr(cron_expression, 'H')) {
+        text = strdup(cron_expression);
+        if (!text) {
+            cron_release(schedule);
+            return -1;
+        }
+    }
+
+    dag->schedule = schedule;
+    dag->cron_expression = text;
+    return 0;
+}
+
 void free_dag(DAG *dag) {
     if (!dag) return;
     
@@ -79,6 +153,11 @@ void free_dag(DAG *dag) {
         current_task = next_task;
     }
     
+    if (dag->schedule && dag->cron_expression != dag->schedule->expression) {
+        free((char*)dag->cron_expression);
+    }
+    cron_release(dag->schedule);
+    dag_plan_release(dag->plan);
     free(dag);
 }
 
@@ -104,6 +183,9 @@ DAGTask* create_dag_task(int dag_id, const char *task_name, const char *task_exe
     task->dag_id = dag_id;
     strncpy(task->task_name, task_name, MAX_TASK_NAME_LENGTH - 1);
     strncpy(task->task_execution, task_execution, MAX_TASK_EXECUTION_LENGTH - 1);
+    task->retry_delay_seconds = DAG_DEFAULT_RETRY_DELAY_SECONDS;
+    task->retry_backoff = DAG_DEFAULT_RETRY_BACKOFF;
+    task->max_retry_delay_seconds = DAG_DEFAULT_MAX_RETRY_DELAY_SECONDS;
     
     task->dependencies = NULL;
     task->dependency_count = 0;
@@ -132,6 +214,23 @@ int add_task_dependency(DAGTask *task, int dependency_task_id, const char *depen
     return 0;
 }
 
+int set_dag_task_cache(DAGTask *task, const char *inputs, const char *output) {
+    char *inputs_copy = inputs && inputs[0] ? strdup(inputs) : NULL;
+    char *output_copy = output && output[0] ? strdup(output) : NULL;
+    if ((inputs && inputs[0] && !inputs_copy) || (output && output[0] && !output_copy)) {
+        log_message("Failed to allocate cache settings of task %s\n", task->task_name);
+        free(inputs_copy);
+        free(output_copy);
+        return -1;
+    }
+
+    free(task->inputs);
+    free(task->output);
+    task->inputs = inputs_copy;
+    task->output = output_copy;
+    return 0;
+}
+
 void free_dag_task(DAGTask *task) {
     if (!task) return;
     
@@ -142,191 +241,427 @@ void free_dag_task(DAGTask *task) {
         current_dep = next_dep;
     }
     
+    free(task->inputs);
+    free(task->output);
     free(task);
 }
 
 // Dependency Resolution Functions
 
-int validate_dag_dependencies(DAG *dag) {
-    if (!dag || !dag->tasks) return 1;
-    
-    // Check for cycle detection
-    if (has_cycle(dag)) {
-        log_message("Cycle detected in DAG %s\n", dag->name);
-        return 0;
+// Guards the reference counts of compiled DAGs
+static pthread_mutex_t plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int compare_compiled_tasks(const void *a, const void *b) {
+    int left = ((const CompiledTask*)a)->id;
+    int right = ((const CompiledTask*)b)->id;
+    return (left > right) - (left < right);
+}
+
+static void free_compiled_dag(CompiledDAG *plan) {
+    free(plan->error);
+    for (int i = 0; i < plan->task_count; i++) {
+        free(plan->tasks[i].inputs);
+        free(plan->tasks[i].output);
     }
-    
-    // Validate that all dependencies exist in the DAG
-    DAGTask *task = dag->tasks;
-    while (task) {
-        TaskDependency *dep = task->dependencies;
-        while (dep) {
-            // Find if dependency task exists in DAG
-            DAGTask *dep_task = dag->tasks;
-            int found = 0;
-            while (dep_task) {
-                if (dep_task->id == dep->task_id) {
-                    found = 1;
+    free(plan->tasks);
+    free(plan->indegree);
+    free(plan->dependent_offsets);
+    free(plan->dependents);
+    free(plan->dependency_offsets);
+    free(plan->dependencies);
+    free(plan->order);
+    free(plan->path_ms);
+    free(plan->durations);
+    free(plan->stale);
+    free(plan->queued);
+    pthread_mutex_destroy(&plan->priority_mutex);
+    free(plan);
+}
+
+// Appends "name -> " style steps of a cycle, ending with "..." once the
+// message is full
+static void append_cycle_step(char *message, size_t size, const char *name, int last) {
+    size_t length = strlen(message);
+    size_t needed = strlen(name) + (last ? 0 : 4);
+    if (length + needed + 4 >= size) {
+        if (length + 4 < size) strcat(message, "...");
+        return;
+    }
+    strcat(message, name);
+    if (!last) strcat(message, " -> ");
+}
+
+// Kahn's algorithm over the dependents rows: tasks whose dependencies are all
+// processed are processed in turn, and anything left over sits on or behind a
+// cycle. A depth-first walk through the leftovers then finds one cycle to
+// report. O(tasks + dependencies), sets plan->valid and plan->error, and
+// keeps the processing order in plan->order when valid.
+// Returns -1 when out of memory.
+int validate_compiled_dag(CompiledDAG *plan) {
+    int count = plan->task_count;
+    int *work = malloc(3 * (count > 0 ? count : 1) * sizeof(int));
+    int *queue = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!work || !queue) {
+        log_message("Failed to allocate memory to validate DAG %s\n", plan->name);
+        free(work);
+        free(queue);
+        return -1;
+    }
+    int *remaining = work;           // unprocessed dependencies per task
+    int *stack_position = work + count;
+    int *cursor = work + 2 * count;
+
+    int head = 0, tail = 0;
+    memcpy(remaining, plan->indegree, count * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        if (remaining[i] == 0) queue[tail++] = i;
+    }
+    while (head < tail) {
+        int task = queue[head++];
+        for (int edge = plan->dependent_offsets[task]; edge < plan->dependent_offsets[task + 1]; edge++) {
+            if (--remaining[plan->dependents[edge]] == 0) queue[tail++] = plan->dependents[edge];
+        }
+    }
+
+    plan->valid = tail == count;
+    if (!plan->valid) {
+        // queue is reused as the walk's stack, stack_position is -1 for
+        // tasks never pushed and -2 for tasks fully explored
+        char message[MAX_ERROR_MESSAGE_LENGTH] = "circular dependency: ";
+        for (int i = 0; i < count; i++) stack_position[i] = -1;
+
+        for (int root = 0; root < count && !plan->error; root++) {
+            if (remaining[root] == 0 || stack_position[root] != -1) continue;
+
+            int depth = 0;
+            queue[depth] = root;
+            stack_position[root] = depth++;
+            cursor[root] = plan->dependent_offsets[root];
+            while (depth > 0 && !plan->error) {
+                int task = queue[depth - 1];
+                if (cursor[task] == plan->dependent_offsets[task + 1]) {
+                    stack_position[task] = -2;
+                    depth--;
+                    continue;
+                }
+
+                int next = plan->dependents[cursor[task]++];
+                if (remaining[next] == 0 || stack_position[next] == -2) continue;
+                if (stack_position[next] >= 0) {
+                    // Back edge: the stack from next up to task is the cycle
+                    for (int i = stack_position[next]; i < depth; i++) {
+                        append_cycle_step(message, sizeof(message), plan->tasks[queue[i]].task_name, 0);
+                    }
+                    append_cycle_step(message, sizeof(message), plan->tasks[next].task_name, 1);
+                    plan->error = strdup(message);
                     break;
                 }
-                dep_task = dep_task->next;
+                queue[depth] = next;
+                stack_position[next] = depth++;
+                cursor[next] = plan->dependent_offsets[next];
             }
-            if (!found) {
-                log_message("Dependency task %d not found in DAG %s\n", dep->task_id, dag->name);
-                return 0;
-            }
-            dep = dep->next;
         }
-        task = task->next;
+        log_message("DAG %s is invalid: %s\n", plan->name, plan->error ? plan->error : message);
     }
-    
-    return 1;
-}
 
-int has_cycle(DAG *dag) {
-    if (!dag || !dag->tasks) return 0;
-    
-    // Simple cycle detection using DFS
-    // For a more robust implementation, consider using Kahn's algorithm
-    int visited[1000] = {0}; // Assuming max 1000 tasks per DAG
-    int rec_stack[1000] = {0};
-    
-    DAGTask *task = dag->tasks;
-    while (task) {
-        if (task->id < 1000 && !visited[task->id]) {
-            if (dfs_cycle_check(dag, task->id, visited, rec_stack)) {
-                return 1;
-            }
-        }
-        task = task->next;
+    free(plan->order);
+    if (plan->valid) {
+        plan->order = queue;
+    } else {
+        plan->order = NULL;
+        free(queue);
     }
-    
+    free(work);
     return 0;
 }
 
-int dfs_cycle_check(DAG *dag, int task_id, int *visited, int *rec_stack) {
-    visited[task_id] = 1;
-    rec_stack[task_id] = 1;
-    
-    // Find the task with this ID
-    DAGTask *task = dag->tasks;
-    while (task && task->id != task_id) {
-        task = task->next;
+CompiledDAG* compile_dag(DAG *dag) {
+    int count = dag->task_count;
+    int edge_count = 0;
+    for (DAGTask *task = dag->tasks; task; task = task->next) {
+        edge_count += task->dependency_count;
     }
-    
-    if (!task) return 0;
-    
-    // Check all dependencies
-    TaskDependency *dep = task->dependencies;
-    while (dep) {
-        if (dep->task_id < 1000) {
-            if (!visited[dep->task_id] && dfs_cycle_check(dag, dep->task_id, visited, rec_stack)) {
-                return 1;
-            }
-            if (rec_stack[dep->task_id]) {
-                return 1;
+
+    CompiledDAG *plan = calloc(1, sizeof(CompiledDAG));
+    if (!plan) {
+        log_message("Failed to allocate memory for compiled DAG %s\n", dag->name);
+        return NULL;
+    }
+    pthread_mutex_init(&plan->priority_mutex, NULL);
+    plan->tasks = calloc(count > 0 ? count : 1, sizeof(CompiledTask));
+    plan->indegree = calloc(count > 0 ? count : 1, sizeof(int));
+    plan->dependent_offsets = calloc(count + 1, sizeof(int));
+    plan->dependents = malloc((edge_count > 0 ? edge_count : 1) * sizeof(int));
+    plan->dependency_offsets = calloc(count + 1, sizeof(int));
+    plan->dependencies = malloc((edge_count > 0 ? edge_count : 1) * sizeof(int));
+    plan->path_ms = calloc(count > 0 ? count : 1, sizeof(long long));
+    if (!plan->tasks || !plan->indegree || !plan->dependent_offsets || !plan->dependents ||
+        !plan->dependency_offsets || !plan->dependencies || !plan->path_ms) {
+        log_message("Failed to allocate memory for compiled DAG %s\n", dag->name);
+        free_compiled_dag(plan);
+        return NULL;
+    }
+
+    plan->dag_id = dag->id;
+    strncpy(plan->name, dag->name, MAX_DAG_NAME_LENGTH - 1);
+    plan->max_parallel_tasks = dag->max_parallel_tasks;
+    plan->task_count = count;
+    plan->refcount = 1;
+
+    int index = 0;
+    for (DAGTask *task = dag->tasks; task && index < count; task = task->next, index++) {
+        CompiledTask *compiled = &plan->tasks[index];
+        compiled->id = task->id;
+        memcpy(compiled->task_name, task->task_name, MAX_TASK_NAME_LENGTH);
+        memcpy(compiled->task_execution, task->task_execution, MAX_TASK_EXECUTION_LENGTH);
+        memcpy(compiled->pool, task->pool, MAX_POOL_NAME_LENGTH);
+        compiled->retries = task->retries;
+        compiled->retry_delay_seconds = task->retry_delay_seconds;
+        compiled->retry_backoff = task->retry_backoff;
+        compiled->max_retry_delay_seconds = task->max_retry_delay_seconds;
+        compiled->timeout_seconds = task->timeout_seconds;
+        compiled->trigger_rule = task->trigger_rule;
+        // Copied, the plan can outlive the DAG
+        compiled->inputs = task->inputs ? strdup(task->inputs) : NULL;
+        compiled->output = task->output ? strdup(task->output) : NULL;
+        if ((task->inputs && !compiled->inputs) || (task->output && !compiled->output)) {
+            log_message("Failed to allocate memory for compiled DAG %s\n", dag->name);
+            free_compiled_dag(plan);
+            return NULL;
+        }
+    }
+    qsort(plan->tasks, count, sizeof(CompiledTask), compare_compiled_tasks);
+
+    // Count each task's dependents and turn the counts into row starts. Filling
+    // a row advances its start to the next row's, so the offsets are shifted
+    // back by one afterwards. Dependencies on tasks outside the DAG are left
+    // out, validation reports them.
+    char missing[MAX_ERROR_MESSAGE_LENGTH] = "";
+    for (DAGTask *task = dag->tasks; task; task = task->next) {
+        for (TaskDependency *dep = task->dependencies; dep; dep = dep->next) {
+            int from = compiled_dag_index(plan, dep->task_id);
+            if (from >= 0) {
+                plan->dependent_offsets[from + 1]++;
+            } else if (!missing[0]) {
+                snprintf(missing, sizeof(missing), "task %s depends on task %d, which is not in the DAG",
+                         task->task_name, dep->task_id);
             }
         }
-        dep = dep->next;
     }
-    
-    rec_stack[task_id] = 0;
-    return 0;
-}
+    for (int i = 0; i < count; i++) {
+        plan->dependent_offsets[i + 1] += plan->dependent_offsets[i];
+    }
+    for (DAGTask *task = dag->tasks; task; task = task->next) {
+        int to = compiled_dag_index(plan, task->id);
+        for (TaskDependency *dep = task->dependencies; dep; dep = dep->next) {
+            int from = compiled_dag_index(plan, dep->task_id);
+            if (from < 0) continue;
+            plan->dependents[plan->dependent_offsets[from]++] = to;
+            plan->indegree[to]++;
+        }
+    }
+    for (int i = count; i > 0; i--) {
+        plan->dependent_offsets[i] = plan->dependent_offsets[i - 1];
+    }
+    plan->dependent_offsets[0] = 0;
 
-ExecutionQueue* create_execution_queue(DAG *dag) {
-    if (!dag || !dag->tasks) return NULL;
-    
-    ExecutionQueue *queue_head = NULL;
-    DAGTask *task = dag->tasks;
-    
-    while (task) {
-        ExecutionQueue *queue_item = malloc(sizeof(ExecutionQueue));
-        if (!queue_item) {
-            log_message("Failed to allocate memory for execution queue item\n");
-            continue;
+    // The reverse rows, built the same way from indegree
+    for (int i = 0; i < count; i++) {
+        plan->dependency_offsets[i + 1] = plan->dependency_offsets[i] + plan->indegree[i];
+    }
+    for (int from = 0; from < count; from++) {
+        for (int edge = plan->dependent_offsets[from]; edge < plan->dependent_offsets[from + 1]; edge++) {
+            plan->dependencies[plan->dependency_offsets[plan->dependents[edge]]++] = from;
         }
-        
-        queue_item->task = task;
-        queue_item->ready_to_run = (task->dependency_count == 0) ? 1 : 0;
-        queue_item->completed_dependencies = 0;
-        queue_item->next = queue_head;
-        queue_head = queue_item;
-        
-        task = task->next;
     }
-    
-    return queue_head;
+    for (int i = count; i > 0; i--) {
+        plan->dependency_offsets[i] = plan->dependency_offsets[i - 1];
+    }
+    plan->dependency_offsets[0] = 0;
+
+    if (missing[0]) {
+        plan->valid = 0;
+        plan->error = strdup(missing);
+        log_message("DAG %s is invalid: %s\n", plan->name, missing);
+    } else if (validate_compiled_dag(plan) < 0) {
+        free_compiled_dag(plan);
+        return NULL;
+    }
+    dag_plan_compute_priorities(plan);
+
+    return plan;
 }
 
-ExecutionQueue* get_ready_tasks(ExecutionQueue *queue) {
-    ExecutionQueue *ready_tasks = NULL;
-    ExecutionQueue *current = queue;
-    
-    while (current) {
-        if (current->ready_to_run) {
-            ExecutionQueue *ready_item = malloc(sizeof(ExecutionQueue));
-            if (ready_item) {
-                *ready_item = *current;
-                ready_item->next = ready_tasks;
-                ready_tasks = ready_item;
-            }
-        }
-        current = current->next;
+CompiledDAG* dag_plan_acquire(CompiledDAG *plan) {
+    if (!plan) return NULL;
+
+    pthread_mutex_lock(&plan_mutex);
+    plan->refcount++;
+    pthread_mutex_unlock(&plan_mutex);
+    return plan;
+}
+
+void dag_plan_release(CompiledDAG *plan) {
+    if (!plan) return;
+
+    pthread_mutex_lock(&plan_mutex);
+    int remaining = --plan->refcount;
+    pthread_mutex_unlock(&plan_mutex);
+    if (remaining == 0) free_compiled_dag(plan);
+}
+
+int compiled_dag_index(const CompiledDAG *plan, int task_id) {
+    int low = 0, high = plan->task_count - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        int id = plan->tasks[middle].id;
+        if (id == task_id) return middle;
+        if (id < task_id) low = middle + 1;
+        else high = middle - 1;
     }
-    
-    return ready_tasks;
+    return -1;
 }
 
-void mark_task_completed(ExecutionQueue *queue, int task_id) {
-    ExecutionQueue *current = queue;
-    
-    // Mark the completed task as not ready to run
-    while (current) {
-        if (current->task->id == task_id) {
-            current->ready_to_run = 0;
-            break;
+static long task_weight_ms(const CompiledDAG *plan, int index) {
+    if (plan->durations && plan->durations[index].count > 0) {
+        return plan->durations[index].median_ms;
+    }
+    return DAG_DEFAULT_TASK_DURATION_MS;
+}
+
+// Weight plus the longest path among the task's dependents
+static long long task_path_ms(const CompiledDAG *plan, int index) {
+    long long longest = 0;
+    for (int edge = plan->dependent_offsets[index]; edge < plan->dependent_offsets[index + 1]; edge++) {
+        long long path = plan->path_ms[plan->dependents[edge]];
+        if (path > longest) longest = path;
+    }
+    return task_weight_ms(plan, index) + longest;
+}
+
+// Caller holds priority_mutex. Returns 1 when the task's median changed,
+// -1 when out of memory.
+static int add_duration_locked(CompiledDAG *plan, int index, long duration_ms) {
+    int count = plan->task_count;
+    if (!plan->durations) {
+        plan->durations = calloc(count, sizeof(TaskDurations));
+        plan->stale = malloc(count * sizeof(int));
+        plan->queued = calloc(count, 1);
+        if (!plan->durations || !plan->stale || !plan->queued) {
+            log_message("Failed to allocate duration history for DAG %s\n", plan->name);
+            free(plan->durations);
+            free(plan->stale);
+            free(plan->queued);
+            plan->durations = NULL;
+            plan->stale = NULL;
+            plan->queued = NULL;
+            return -1;
         }
-        current = current->next;
     }
-    
-    // Update dependency counts for tasks that depend on this one
-    current = queue;
-    while (current) {
-        if (current->task->id != task_id) {
-            TaskDependency *dep = current->task->dependencies;
-            while (dep) {
-                if (dep->task_id == task_id) {
-                    current->completed_dependencies++;
-                    if (current->completed_dependencies >= current->task->dependency_count) {
-                        current->ready_to_run = 1;
-                    }
-                    break;
-                }
-                dep = dep->next;
+
+    TaskDurations *history = &plan->durations[index];
+    if (duration_ms < 0) duration_ms = 0;
+    if (duration_ms > INT_MAX) duration_ms = INT_MAX;
+    history->samples[history->next] = (int)duration_ms;
+    history->next = (history->next + 1) % DAG_DURATION_SAMPLES;
+    if (history->count < DAG_DURATION_SAMPLES) history->count++;
+
+    // Insertion sort, the ring holds at most DAG_DURATION_SAMPLES
+    int sorted[DAG_DURATION_SAMPLES];
+    for (int i = 0; i < history->count; i++) {
+        int value = history->samples[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    long median = history->count % 2 ? sorted[history->count / 2]
+                                     : ((long)sorted[history->count / 2 - 1] + sorted[history->count / 2]) / 2;
+    int changed = history->count == 1 || median != history->median_ms;
+    history->median_ms = median;
+    return changed;
+}
+
+int dag_plan_add_duration(CompiledDAG *plan, int index, long duration_ms) {
+    if (!plan || index < 0 || index >= plan->task_count) return -1;
+
+    pthread_mutex_lock(&plan->priority_mutex);
+    int changed = add_duration_locked(plan, index, duration_ms);
+    pthread_mutex_unlock(&plan->priority_mutex);
+    return changed;
+}
+
+// Only the paths through the task can change: it is recomputed, and every
+// dependency of a task whose path moved is queued for the same, so the walk
+// stops where the longest path runs through another branch.
+void dag_plan_record_duration(CompiledDAG *plan, int index, long duration_ms) {
+    if (!plan || !plan->valid || index < 0 || index >= plan->task_count) return;
+
+    pthread_mutex_lock(&plan->priority_mutex);
+    if (add_duration_locked(plan, index, duration_ms) > 0) {
+        int depth = 0;
+        plan->stale[depth++] = index;
+        plan->queued[index] = 1;
+        while (depth > 0) {
+            int task = plan->stale[--depth];
+            plan->queued[task] = 0;
+
+            long long path = task_path_ms(plan, task);
+            if (path == plan->path_ms[task]) continue;
+            plan->path_ms[task] = path;
+            for (int edge = plan->dependency_offsets[task]; edge < plan->dependency_offsets[task + 1]; edge++) {
+                int dependency = plan->dependencies[edge];
+                if (plan->queued[dependency]) continue;
+                plan->queued[dependency] = 1;
+                plan->stale[depth++] = dependency;
             }
         }
-        current = current->next;
     }
+    pthread_mutex_unlock(&plan->priority_mutex);
+}
+
+// Reverse topological order reaches every dependent before its dependencies
+void dag_plan_compute_priorities(CompiledDAG *plan) {
+    if (!plan || !plan->order) return;
+
+    pthread_mutex_lock(&plan->priority_mutex);
+    for (int i = plan->task_count - 1; i >= 0; i--) {
+        int task = plan->order[i];
+        plan->path_ms[task] = task_path_ms(plan, task);
+    }
+    pthread_mutex_unlock(&plan->priority_mutex);
+}
+
+void dag_plan_copy_priorities(CompiledDAG *plan, long long *priorities) {
+    pthread_mutex_lock(&plan->priority_mutex);
+    memcpy(priorities, plan->path_ms, plan->task_count * sizeof(long long));
+    pthread_mutex_unlock(&plan->priority_mutex);
 }
 
 // DAG Execution Functions
 
+// Runs of a DAG can start within the same second, the sequence number keeps
+// their ids apart so a single run can be addressed
 char* generate_execution_id(int dag_id) {
-    char *execution_id = malloc(64);
+    static unsigned int sequence = 0;
+    char *execution_id = malloc(MAX_EXECUTION_ID_LENGTH);
     if (!execution_id) return NULL;
     
-    time_t now = time(NULL);
-    snprintf(execution_id, 64, "dag_%d_%ld", dag_id, now);
+    time_t now = clock_now();
+    snprintf(execution_id, MAX_EXECUTION_ID_LENGTH, "dag_%d_%ld_%u", dag_id, now,
+             __atomic_add_fetch(&sequence, 1, __ATOMIC_RELAXED));
     return execution_id;
 }
 
-int start_dag_execution(sqlite3 *db, int dag_id, char *execution_id) {
+int start_dag_execution(sqlite3 *db, int dag_id, char *execution_id, long dispatch_delay_ms) {
     DAGExecution execution = {0};
     execution.dag_id = dag_id;
+    execution.dispatch_delay_ms = dispatch_delay_ms;
     strncpy(execution.execution_id, execution_id, sizeof(execution.execution_id) - 1);
     execution.status = EXECUTION_STATUS_RUNNING;
-    execution.started_at = time(NULL);
+    execution.started_at = clock_now();
     
     return insert_dag_execution_db(db, &execution);
 }
\ No newline at end of file
@@ -3,15 +3,32 @@
 
 #include <sqlite3.h>
 #include <time.h>
+#include <pthread.h>
+#include "cron.h"
 
 // Maximum limits for DAG components
 #define MAX_DAG_NAME_LENGTH 128
 #define MAX_TASK_NAME_LENGTH 64
 #define MAX_TASK_EXECUTION_LENGTH 256
-#define MAX_CRON_EXPRESSION_LENGTH 64
 #define MAX_DESCRIPTION_LENGTH 512
 #define MAX_ERROR_MESSAGE_LENGTH 1024
 #define MAX_DEPENDENCIES 32
+#define MAX_POOL_NAME_LENGTH 64
+#define MAX_TASK_PATH_LENGTH 256
+#define MAX_TASK_INPUTS_LENGTH 1024
+#define MAX_EXECUTION_ID_LENGTH 64
+
+// Critical path weights: a task weighs the median of its most recent
+// successful durations, or the default until it has completed once
+#define DAG_DURATION_SAMPLES 9
+#define DAG_DEFAULT_TASK_DURATION_MS 1000
+
+// Retry defaults: the first retry waits retry_delay_seconds, each one after
+// that retry_backoff times longer, never more than max_retry_delay_seconds
+#define DAG_DEFAULT_RETRY_DELAY_SECONDS 30
+#define DAG_DEFAULT_RETRY_BACKOFF 2.0
+#define DAG_DEFAULT_MAX_RETRY_DELAY_SECONDS 3600
+#define DAG_MAX_TASK_RETRIES 100
 
 // DAG and task status definitions
 typedef enum {
@@ -26,12 +43,38 @@ typedef enum {
     EXECUTION_STATUS_SUCCESS,
     EXECUTION_STATUS_FAILED,
     EXECUTION_STATUS_CANCELLED,
-    EXECUTION_STATUS_SKIPPED
+    EXECUTION_STATUS_SKIPPED,
+    EXECUTION_STATUS_CACHED     // succeeded, its result came from the task cache
 } ExecutionStatus;
 
+// What a scheduled start does while the DAG already has max_active_runs runs:
+// wait in the DAG's run queue, be dropped, or cancel the runs in the way and
+// then wait for their slots
+typedef enum {
+    OVERLAP_POLICY_QUEUE,
+    OVERLAP_POLICY_SKIP,
+    OVERLAP_POLICY_CANCEL_PREVIOUS
+} OverlapPolicy;
+
+// When a task runs, decided from how its dependencies ended. A task whose
+// rule can no longer be met is skipped, and counts as skipped upstream for
+// its own dependents.
+// ALL_SUCCESS: every dependency succeeded, skipped once one fails or is skipped
+// ALL_DONE: every dependency finished, however it ended
+// ONE_FAILED: as soon as one dependency failed, skipped if none did
+// NONE_FAILED: every dependency succeeded or was skipped
+typedef enum {
+    TRIGGER_RULE_ALL_SUCCESS,
+    TRIGGER_RULE_ALL_DONE,
+    TRIGGER_RULE_ONE_FAILED,
+    TRIGGER_RULE_NONE_FAILED
+} TriggerRule;
+
 // Forward declarations
 struct DAGTask;
 struct DAG;
+struct ScheduleGroup;
+struct CompiledDAG;
 
 // Dependency structure for tasks
 typedef struct TaskDependency {
@@ -46,6 +89,15 @@ typedef struct DAGTask {
     int dag_id;
     char task_name[MAX_TASK_NAME_LENGTH];
     char task_execution[MAX_TASK_EXECUTION_LENGTH];
+    char pool[MAX_POOL_NAME_LENGTH];   // resource pool limiting it, empty for none
+    int retries;                       // attempts after the first before the task fails
+    int retry_delay_seconds;
+    double retry_backoff;
+    int max_retry_delay_seconds;
+    int timeout_seconds;               // wall time per attempt before it is killed, 0 = no limit
+    TriggerRule trigger_rule;
+    char *inputs;                      // files its result depends on, one per line, NULL when uncached
+    char *output;                      // file it writes, restored on a cache hit, NULL for none
     TaskDependency *dependencies;
     int dependency_count;
     struct DAGTask *next;
@@ -55,13 +107,21 @@ typedef struct DAGTask {
 typedef struct DAG {
     int id;
     char name[MAX_DAG_NAME_LENGTH];
-    char cron_expression[MAX_CRON_EXPRESSION_LENGTH];
+    const char *cron_expression;       // as written, may contain H tokens
+    const CronSchedule *schedule;      // interned, shared with every DAG resolving to the same expression
+    struct ScheduleGroup *group;       // scheduler bookkeeping, NULL while not scheduled
+    struct DAG *group_prev;
+    struct DAG *group_next;
     char description[MAX_DESCRIPTION_LENGTH];
     DAGStatus status;
     time_t created_at;
     time_t updated_at;
     DAGTask *tasks;
     int task_count;
+    int max_parallel_tasks;            // tasks of one run executing at once, 0 = no per-DAG limit
+    int max_active_runs;               // runs executing at once, 0 = no limit
+    OverlapPolicy overlap_policy;
+    struct CompiledDAG *plan;          // what runs execute, NULL until compile_dag
     struct DAG *next;
 } DAG;
 
@@ -73,6 +133,7 @@ typedef struct DAGExecution {
     ExecutionStatus status;
     time_t started_at;
     time_t completed_at;
+    long dispatch_delay_ms;  // time the run waited for start budget
     char error_message[MAX_ERROR_MESSAGE_LENGTH];
     struct DAGExecution *next;
 } DAGExecution;
@@ -84,43 +145,110 @@ typedef struct TaskExecution {
     int task_id;
     char task_name[MAX_TASK_NAME_LENGTH];
     ExecutionStatus status;
+    int attempt;             // 1 for the first run of the task in its DAG run
     time_t started_at;
     time_t completed_at;
     char error_message[MAX_ERROR_MESSAGE_LENGTH];
     struct TaskExecution *next;
 } TaskExecution;
 
-// Execution queue for managing task dependencies
-typedef struct ExecutionQueue {
-    DAGTask *task;
-    int ready_to_run;
-    int completed_dependencies;
-    struct ExecutionQueue *next;
-} ExecutionQueue;
+// Task of a compiled DAG, addressed by its dense index
+typedef struct CompiledTask {
+    int id;
+    char task_name[MAX_TASK_NAME_LENGTH];
+    char task_execution[MAX_TASK_EXECUTION_LENGTH];
+    char pool[MAX_POOL_NAME_LENGTH];
+    int retries;
+    int retry_delay_seconds;
+    double retry_backoff;
+    int max_retry_delay_seconds;
+    int timeout_seconds;
+    TriggerRule trigger_rule;
+    char *inputs;
+    char *output;
+} CompiledTask;
+
+// Recent durations of one task, a ring of the last DAG_DURATION_SAMPLES
+typedef struct TaskDurations {
+    int samples[DAG_DURATION_SAMPLES];
+    int count;
+    int next;
+    long median_ms;
+} TaskDurations;
+
+// A DAG frozen for execution. Tasks sit in one array ordered by id, the
+// tasks depending on task i are dependents[dependent_offsets[i]] up to
+// dependents[dependent_offsets[i + 1]] (CSR), and indegree[i] counts the
+// dependencies of task i. A run only needs a copy of indegree as its state.
+// Runs hold a reference, so a reload can replace the DAG under them.
+// path_ms[i] is the longest duration-weighted path from task i to a sink,
+// task i included; runs dispatch the ready task with the longest one first.
+// Durations and path lengths change while runs finish tasks, so they are
+// read and written under priority_mutex.
+typedef struct CompiledDAG {
+    int dag_id;
+    char name[MAX_DAG_NAME_LENGTH];
+    int max_parallel_tasks;
+    int valid;                // acyclic and every dependency is in the DAG
+    char *error;              // why not, NULL when valid
+    int task_count;
+    CompiledTask *tasks;
+    int *indegree;
+    int *dependent_offsets;   // task_count + 1 entries
+    int *dependents;
+    int *dependency_offsets;  // the same edges the other way round
+    int *dependencies;
+    int *order;               // topological order, NULL when invalid
+    pthread_mutex_t priority_mutex;
+    long long *path_ms;
+    TaskDurations *durations; // NULL until a duration is recorded
+    int *stale;               // scratch for updates, allocated with durations
+    char *queued;
+    int refcount;
+} CompiledDAG;
 
 // DAG Management Functions
 DAG* create_dag(const char *name, const char *cron_expression, const char *description);
+int dag_set_schedule(DAG *dag, const char *cron_expression);
 void free_dag(DAG *dag);
 void free_dag_list(DAG *dag_list);
 
 // DAG Task Management Functions
 DAGTask* create_dag_task(int dag_id, const char *task_name, const char *task_execution);
 int add_task_dependency(DAGTask *task, int dependency_task_id, const char *dependency_task_name);
+// Copies the task's cache settings, NULL or empty leaves one unset
+int set_dag_task_cache(DAGTask *task, const char *inputs, const char *output);
 void free_dag_task(DAGTask *task);
 
 // Dependency Resolution Functions
-int validate_dag_dependencies(DAG *dag);
-int has_cycle(DAG *dag);
-int dfs_cycle_check(DAG *dag, int task_id, int *visited, int *rec_stack);
-ExecutionQueue* create_execution_queue(DAG *dag);
-ExecutionQueue* get_ready_tasks(ExecutionQueue *queue);
-void mark_task_completed(ExecutionQueue *queue, int task_id);
+// Compiled DAGs, one reference is held by the DAG that built it. Compiling
+// validates the dependencies once, runs only read the result.
+CompiledDAG* compile_dag(DAG *dag);
+int validate_compiled_dag(CompiledDAG *plan);
+CompiledDAG* dag_plan_acquire(CompiledDAG *plan);
+void dag_plan_release(CompiledDAG *plan);
+// Dense index of a task id, -1 when the task isn't in the plan
+int compiled_dag_index(const CompiledDAG *plan, int task_id);
+// Adds a successful duration to a task's history. dag_plan_record_duration
+// also walks the change up the dependencies, what runs do as tasks finish;
+// loaders add the whole history and call dag_plan_compute_priorities once.
+int dag_plan_add_duration(CompiledDAG *plan, int index, long duration_ms);
+void dag_plan_record_duration(CompiledDAG *plan, int index, long duration_ms);
+void dag_plan_compute_priorities(CompiledDAG *plan);
+// Copies path_ms, task_count entries
+void dag_plan_copy_priorities(CompiledDAG *plan, long long *priorities);
 
 // Utility Functions
 const char* execution_status_to_string(ExecutionStatus status);
 ExecutionStatus string_to_execution_status(const char *status);
 const char* dag_status_to_string(DAGStatus status);
 DAGStatus string_to_dag_status(const char *status);
+const char* overlap_policy_to_string(OverlapPolicy policy);
+// -1 when policy isn't one of the names
+int string_to_overlap_policy(const char *policy);
+const char* trigger_rule_to_string(TriggerRule rule);
+// -1 when rule isn't one of the names
+int string_to_trigger_rule(const char *rule);
 
 // Database Functions (declared here, implemented in database.c)
 int insert_dag_db(sqlite3 *db, DAG *dag);
@@ -128,7 +256,11 @@ int insert_dag_task_db(sqlite3 *db, DAGTask *task);
 int insert_dag_execution_db(sqlite3 *db, DAGExecution *execution);
 int insert_task_execution_db(sqlite3 *db, TaskExecution *execution);
 int update_dag_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message);
-int update_task_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message);
+// duration_ms < 0 leaves the duration empty
+int update_task_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message,
+                                    long duration_ms);
+// Recent successful durations of the plan's tasks, then its priorities
+int load_task_durations_db(sqlite3 *db, CompiledDAG *plan);
 
 DAG* load_dag_by_id_db(sqlite3 *db, int dag_id);
 DAG* load_all_dags_db(sqlite3 *db);
@@ -136,11 +268,13 @@ DAGExecution* load_dag_executions_db(sqlite3 *db, int dag_id);
 TaskExecution* load_task_executions_db(sqlite3 *db, int dag_execution_id);
 
 int delete_dag_by_id_db(sqlite3 *db, int dag_id);
-int update_dag_db(sqlite3 *db, int dag_id, const char *name, const char *cron_expression, const char *description);
+// max_parallel_tasks, max_active_runs and overlap_policy < 0 keep the stored setting
+int update_dag_db(sqlite3 *db, int dag_id, const char *name, const char *cron_expression, const char *description,
+                  int max_parallel_tasks, int max_active_runs, int overlap_policy);
 
 // DAG Execution Functions
 char* generate_execution_id(int dag_id);
-int start_dag_execution(sqlite3 *db, int dag_id, char *execution_id);
+int start_dag_execution(sqlite3 *db, int dag_id, char *execution_id, long dispatch_delay_ms);
 int execute_dag_task(sqlite3 *db, TaskExecution *task_execution);
 
 #endif
\ No newline at end of file
@@ -3,230 +3,1583 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <stdint.h>
 #include <pthread.h>
 #include "dag_scheduler.h"
 #include "dag.h"
 #include "database.h"
 #include "logger.h"
 #include "thread.h"
+#include "wakeup.h"
+#include "clock_source.h"
+#include "stack.h"
+#include "timing_wheel.h"
+#include "cron_table.h"
+#include "task_executor.h"
+#include "task_cache.h"
 
 // Global DAG list
 static DAG *dag_list_head = NULL;
 static pthread_mutex_t dag_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SchedulerWakeup dag_list_changed = SCHEDULER_WAKEUP_INITIALIZER;
+
+// Last second already dispatched, every schedule is evaluated strictly after it
+static time_t dag_cursor = 0;
+
+// Start rate limit: a token bucket refilled at dag_start_rate tokens per
+// second holding at most one second worth of burst. Runs over budget wait in
+// a FIFO, guarded by dag_list_mutex. A rate of 0 disables the limit.
+typedef struct PendingStart {
+    DAG *dag;
+    long long queued_ms;
+} PendingStart;
+
+static double dag_start_rate = DAG_START_RATE_DEFAULT;
+static double start_tokens = -1;  // -1 until the first refill fills the bucket
+static long long start_tokens_ms = 0;
+static PendingStart pending_starts[DAG_START_QUEUE_CAPACITY];
+static int pending_head = 0;
+static int pending_count = 0;
+
+// DAGs sharing an interned schedule are queued and fired as one group, so a
+// schedule is evaluated once per fire no matter how many DAGs use it
+typedef struct ScheduleGroup {
+    const CronSchedule *schedule;  // kept alive by the member DAGs
+    DAG *members;
+    int member_count;
+    int row;                       // in group_schedules, -1 if it couldn't be added
+#ifdef CONDUIT_TIMING_WHEEL
+    WheelNode timer;
+#else
+    TimerNode timer;
+#endif
+    struct ScheduleGroup *next;    // hash chain
+} ScheduleGroup;
+
+// Groups by schedule pointer, guarded by dag_list_mutex
+static ScheduleGroup **group_buckets = NULL;
+static int group_bucket_count = 0;
+static int group_count = 0;
+
+// The schedule of every group as one row of a column table, so the forecast
+// can ask which groups fire in a minute for the whole catalog at once.
+// group_rows maps a row back to its group, guarded by dag_list_mutex.
+static CronTable group_schedules;
+static ScheduleGroup **group_rows = NULL;
+static int group_rows_capacity = 0;
+
+// Next fire time of every schedule group, guarded by dag_list_mutex.
+// Build with SCHEDULE_QUEUE=wheel for the timing wheel, the heap is the default.
+#ifdef CONDUIT_TIMING_WHEEL
+static TimingWheel dag_timers;
+
+static void dag_queue_reset(void) {
+    timing_wheel_init(&dag_timers, dag_cursor);
+}
+
+static void dag_queue_node_init(ScheduleGroup *group) {
+    wheel_node_init(&group->timer, group);
+}
+
+static void dag_queue_set(ScheduleGroup *group, time_t due) {
+    timing_wheel_insert(&dag_timers, &group->timer, due);
+}
+
+static void dag_queue_remove(ScheduleGroup *group) {
+    timing_wheel_cancel(&dag_timers, &group->timer);
+}
+
+static time_t dag_queue_next_due(void) {
+    return timing_wheel_next_wakeup(&dag_timers);
+}
+
+static ScheduleGroup* dag_queue_pop_due(time_t now, time_t *due) {
+    timing_wheel_advance(&dag_timers, now);
+    WheelNode *node = timing_wheel_pop_expired(&dag_timers);
+    if (!node) return NULL;
+    *due = node->due;
+    return node->owner;
+}
+#else
+static TimerHeap dag_timers = { NULL, 0, 0 };
+
+static void dag_queue_reset(void) {
+    timer_heap_clear(&dag_timers);
+}
+
+static void dag_queue_node_init(ScheduleGroup *group) {
+    timer_node_init(&group->timer, group);
+}
+
+static void dag_queue_set(ScheduleGroup *group, time_t due) {
+    timer_heap_update(&dag_timers, &group->timer, due);
+}
+
+static void dag_queue_remove(ScheduleGroup *group) {
+    timer_heap_remove(&dag_timers, &group->timer);
+}
+
+static time_t dag_queue_next_due(void) {
+    TimerNode *next = timer_heap_peek(&dag_timers);
+    return next ? next->due : -1;
+}
+
+static ScheduleGroup* dag_queue_pop_due(time_t now, time_t *due) {
+    TimerNode *next = timer_heap_peek(&dag_timers);
+    if (!next || next->due > now) return NULL;
+    *due = next->due;
+    timer_heap_pop(&dag_timers);
+    return next->owner;
+}
+#endif
 
 // DAG Scheduler Functions
 
+static ScheduleGroup** group_bucket(const CronSchedule *schedule) {
+    return &group_buckets[((uintptr_t)schedule >> 4) % group_bucket_count];
+}
+
+static int group_table_grow(void) {
+    int bucket_count = group_bucket_count ? group_bucket_count * 2 : 64;
+    ScheduleGroup **buckets = calloc(bucket_count, sizeof(ScheduleGroup*));
+    if (!buckets) return -1;
+
+    ScheduleGroup **old_buckets = group_buckets;
+    int old_count = group_bucket_count;
+    group_buckets = buckets;
+    group_bucket_count = bucket_count;
+
+    for (int i = 0; i < old_count; i++) {
+        ScheduleGroup *group = old_buckets[i];
+        while (group) {
+            ScheduleGroup *next = group->next;
+            ScheduleGroup **bucket = group_bucket(group->schedule);
+            group->next = *bucket;
+            *bucket = group;
+            group = next;
+        }
+    }
+
+    free(old_buckets);
+    return 0;
+}
+
+static void group_row_add(ScheduleGroup *group) {
+    group->row = -1;
+    if (group_schedules.count == group_rows_capacity) {
+        int capacity = group_rows_capacity ? group_rows_capacity * 2 : 64;
+        ScheduleGroup **rows = realloc(group_rows, capacity * sizeof(ScheduleGroup*));
+        if (!rows) return;
+        group_rows = rows;
+        group_rows_capacity = capacity;
+    }
+
+    int row = cron_table_append(&group_schedules, group->schedule);
+    if (row < 0) return;
+    group_rows[row] = group;
+    group->row = row;
+}
+
+static void group_row_remove(ScheduleGroup *group) {
+    if (group->row < 0) return;
+    int moved = cron_table_remove(&group_schedules, group->row);
+    if (moved >= 0) {
+        group_rows[group->row] = group_rows[moved];
+        group_rows[group->row]->row = group->row;
+    }
+    group->row = -1;
+}
+
+// Returns the group of a schedule, creating and queueing it on first use
+static ScheduleGroup* group_for_schedule(const CronSchedule *schedule) {
+    if (group_bucket_count) {
+        for (ScheduleGroup *group = *group_bucket(schedule); group; group = group->next) {
+            if (group->schedule == schedule) return group;
+        }
+    }
+
+    if (group_count >= group_bucket_count && group_table_grow() != 0 && group_bucket_count == 0) {
+        return NULL;
+    }
+
+    ScheduleGroup *group = calloc(1, sizeof(ScheduleGroup));
+    if (!group) return NULL;
+
+    group->schedule = schedule;
+    group_row_add(group);
+    if (group->row < 0) {
+        log_message("Schedule %s left out of the forecast, out of memory\n", schedule->expression);
+    }
+    dag_queue_node_init(group);
+    ScheduleGroup **bucket = group_bucket(schedule);
+    group->next = *bucket;
+    *bucket = group;
+    group_count++;
+
+    time_t next_run = cron_next_fire(schedule, dag_cursor);
+    if (next_run != -1) dag_queue_set(group, next_run);
+    return group;
+}
+
+static void group_add(DAG *dag) {
+    ScheduleGroup *group = group_for_schedule(dag->schedule);
+    if (!group) {
+        log_message("Failed to allocate schedule group for DAG %s\n", dag->name);
+        return;
+    }
+
+    dag->group = group;
+    dag->group_prev = NULL;
+    dag->group_next = group->members;
+    if (group->members) group->members->group_prev = dag;
+    group->members = dag;
+    group->member_count++;
+}
+
+// Takes the DAG out of its group, dropping the group with its last member
+static void group_remove(DAG *dag) {
+    ScheduleGroup *group = dag->group;
+    if (!group) return;
+
+    if (dag->group_prev) {
+        dag->group_prev->group_next = dag->group_next;
+    } else {
+        group->members = dag->group_next;
+    }
+    if (dag->group_next) dag->group_next->group_prev = dag->group_prev;
+    dag->group = NULL;
+    dag->group_prev = NULL;
+    dag->group_next = NULL;
+
+    if (--group->member_count > 0) return;
+
+    dag_queue_remove(group);
+    group_row_remove(group);
+    ScheduleGroup **link = group_bucket(group->schedule);
+    while (*link != group) link = &(*link)->next;
+    *link = group->next;
+    group_count--;
+    free(group);
+}
+
+static void free_schedule_groups(void) {
+    for (int i = 0; i < group_bucket_count; i++) {
+        ScheduleGroup *group = group_buckets[i];
+        while (group) {
+            ScheduleGroup *next = group->next;
+            free(group);
+            group = next;
+        }
+        group_buckets[i] = NULL;
+    }
+    group_count = 0;
+    cron_table_free(&group_schedules);
+    dag_queue_reset();
+}
+
+// Moves the DAG into the group of its current schedule, or out of any group
+// when it can't run, must hold dag_list_mutex
+static void schedule_dag_locked(DAG *dag) {
+    int schedulable = dag->status == DAG_STATUS_ACTIVE && dag->schedule && dag->schedule->valid;
+
+    if (dag->group && (!schedulable || dag->group->schedule != dag->schedule)) {
+        group_remove(dag);
+    }
+    if (schedulable && !dag->group) {
+        group_add(dag);
+    }
+}
+
+void set_dag_start_rate(double starts_per_second) {
+    pthread_mutex_lock(&dag_list_mutex);
+    dag_start_rate = starts_per_second > 0 ? starts_per_second : 0;
+    start_tokens = -1;
+    wakeup_notify(&dag_list_changed);
+    pthread_mutex_unlock(&dag_list_mutex);
+}
+
+static double start_bucket_size(void) {
+    return dag_start_rate > 1 ? dag_start_rate : 1;
+}
+
+static void refill_start_tokens(long long now_ms) {
+    if (start_tokens < 0) {
+        start_tokens = start_bucket_size();
+    } else {
+        start_tokens += (now_ms - start_tokens_ms) * dag_start_rate / 1000.0;
+        if (start_tokens > start_bucket_size()) start_tokens = start_bucket_size();
+    }
+    start_tokens_ms = now_ms;
+}
+
+// Run slots are kept further down, next to the runs. Reloads hand them the
+// DAG's new limit and plan, or NULL when the DAG is gone.
+static void sync_run_slots(sqlite3 *db, int dag_id, const DAG *dag);
+static void sync_all_run_slots(sqlite3 *db);
+
+// Forgets queued starts of a DAG about to be freed, or all of them for NULL
+static void drop_pending_starts(DAG *dag) {
+    int kept = 0;
+    for (int i = 0; i < pending_count; i++) {
+        PendingStart entry = pending_starts[(pending_head + i) % DAG_START_QUEUE_CAPACITY];
+        if (dag && entry.dag != dag) {
+            pending_starts[(pending_head + kept) % DAG_START_QUEUE_CAPACITY] = entry;
+            kept++;
+        }
+    }
+    pending_count = kept;
+}
+
 void load_dags_from_database(sqlite3 *db) {
+    // Read the catalog before taking the lock, the scheduler and API keep going meanwhile
+    DAG *loaded = load_all_dags_db(db);
+
     pthread_mutex_lock(&dag_list_mutex);
     
     // Free existing DAG list
+    if (dag_cursor == 0) dag_cursor = clock_now();
+    drop_pending_starts(NULL);
+    free_schedule_groups();
     if (dag_list_head) {
         free_dag_list(dag_list_head);
         dag_list_head = NULL;
     }
     
-    // Load DAGs from database
-    dag_list_head = load_all_dags_db(db);
+    dag_list_head = loaded;
+    int dag_count = 0;
+    for (DAG *dag = dag_list_head; dag; dag = dag->next) {
+        schedule_dag_locked(dag);
+        dag_count++;
+    }
+    int schedule_count = group_count;
+    sync_all_run_slots(db);
     
+    // Wake the scheduler so it recomputes its next deadline
+    wakeup_notify(&dag_list_changed);
     pthread_mutex_unlock(&dag_list_mutex);
     
     if (dag_list_head) {
-        log_message("Loaded DAGs from database\n");
+        log_message("Loaded %d DAGs from database sharing %d schedules\n", dag_count, schedule_count);
     } else {
         log_message("No DAGs found in database\n");
     }
 }
 
-int is_dag_time_to_run(const char *cronExpression, struct CronTime now) {
-    char *fields[5];
-    char *copy = strdup(cronExpression);
-    char *token = strtok(copy, " ");
+// Re-reads a single DAG after it was created, edited or deleted and only moves
+// its own queue entry instead of reloading the whole catalog
+void refresh_dag(sqlite3 *db, int dag_id) {
+    DAG *loaded = load_dag_by_id_db(db, dag_id);
 
-    for (int i = 0; i < 5; i++) {
-        if (!token) {
-            free(copy);
-            return 0;
-        }
-        fields[i] = token;
-        token = strtok(NULL, " ");
+    pthread_mutex_lock(&dag_list_mutex);
+    if (dag_cursor == 0) {
+        dag_cursor = clock_now();
+        dag_queue_reset();
     }
 
-    int result = 1;
-    result &= match_cron_field(fields[0], now.minute, 0, 59);
-    result &= match_cron_field(fields[1], now.hour, 0, 23);
-    result &= match_cron_field(fields[2], now.day_of_month, 1, 31);
-    result &= match_cron_field(fields[3], now.month, 1, 12);
-    result &= match_cron_field(fields[4], now.day_of_week, 0, 6);
+    DAG **link = &dag_list_head;
+    while (*link && (*link)->id != dag_id) {
+        link = &(*link)->next;
+    }
+    DAG *existing = *link;
 
-    free(copy);
-    return result;
+    if (!loaded || loaded->status != DAG_STATUS_ACTIVE) {
+        // Deleted or deactivated
+        if (existing) {
+            group_remove(existing);
+            drop_pending_starts(existing);
+            *link = existing->next;
+            free_dag(existing);
+        }
+        free_dag(loaded);
+        sync_run_slots(db, dag_id, NULL);
+    } else if (existing) {
+        // Edited: keep the node where it is and swap its contents, the old
+        // tasks, schedule and plan references are released with `loaded`
+        DAGTask *old_tasks = existing->tasks;
+        const CronSchedule *old_schedule = existing->schedule;
+        const char *old_expression = existing->cron_expression;
+        CompiledDAG *old_plan = existing->plan;
+        strncpy(existing->name, loaded->name, MAX_DAG_NAME_LENGTH - 1);
+        strncpy(existing->description, loaded->description, MAX_DESCRIPTION_LENGTH - 1);
+        existing->schedule = loaded->schedule;
+        existing->cron_expression = loaded->cron_expression;
+        existing->status = loaded->status;
+        existing->updated_at = loaded->updated_at;
+        existing->tasks = loaded->tasks;
+        existing->task_count = loaded->task_count;
+        existing->max_parallel_tasks = loaded->max_parallel_tasks;
+        existing->max_active_runs = loaded->max_active_runs;
+        existing->overlap_policy = loaded->overlap_policy;
+        existing->plan = loaded->plan;
+
+        schedule_dag_locked(existing);
+        sync_run_slots(db, dag_id, existing);
+        loaded->tasks = old_tasks;
+        loaded->schedule = old_schedule;
+        loaded->cron_expression = old_expression;
+        loaded->plan = old_plan;
+        free_dag(loaded);
+    } else {
+        loaded->next = dag_list_head;
+        dag_list_head = loaded;
+        schedule_dag_locked(loaded);
+    }
+
+    wakeup_notify(&dag_list_changed);
+    pthread_mutex_unlock(&dag_list_mutex);
 }
 
-int execute_dag(sqlite3 *db, DAG *dag) {
-    if (!dag || dag->status != DAG_STATUS_ACTIVE) {
+// A stretch of real time that stays inside one local hour
+typedef struct ForecastBlock {
+    int month;
+    int day;
+    int weekday;
+    int hour;
+    int first_minute;  // local minutes covered, inclusive
+    int last_minute;
+    int offset;        // index of first_minute in the forecast
+} ForecastBlock;
+
+// Counts the DAG runs and tasks every schedule group will start in each of
+// the `minutes` minutes from `start` (minute aligned). One pass over the
+// schedule table per local hour finds the groups firing in it, their minute
+// masks give the minutes. Hours are walked in real time so DST changes are followed.
+int schedule_forecast(time_t start, int minutes, ForecastMinute *counts) {
+    // One block per hour, plus the partial first and last hours and DST shifts
+    int block_capacity = minutes / 60 + 8;
+    ForecastBlock *blocks = malloc(block_capacity * sizeof(ForecastBlock));
+    if (!blocks) return -1;
+
+    int block_count = 0;
+    time_t block_start = start;
+    for (int offset = 0; offset < minutes && block_count < block_capacity; ) {
+        struct tm local;
+        localtime_r(&block_start, &local);
+
+        int length = 60 - local.tm_min;
+        if (length > minutes - offset) length = minutes - offset;
+
+        blocks[block_count++] = (ForecastBlock){
+            local.tm_mon + 1, local.tm_mday, local.tm_wday, local.tm_hour,
+            local.tm_min, local.tm_min + length - 1, offset
+        };
+        offset += length;
+        block_start += (time_t)length * 60;
+    }
+
+    memset(counts, 0, minutes * sizeof(ForecastMinute));
+
+    pthread_mutex_lock(&dag_list_mutex);
+    int rows = group_schedules.count;
+    uint64_t *due = malloc((CRON_TABLE_WORDS(rows) + 1) * sizeof(uint64_t));
+    ForecastMinute *row_starts = malloc((rows + 1) * sizeof(ForecastMinute));
+    if (!due || !row_starts) {
+        pthread_mutex_unlock(&dag_list_mutex);
+        free(due);
+        free(row_starts);
+        free(blocks);
         return -1;
     }
+
+    // What one matching minute of each row starts
+    for (int row = 0; row < rows; row++) {
+        ScheduleGroup *group = group_rows[row];
+        int fires = cron_fires_per_minute(group->schedule);
+        int tasks = 0;
+        for (DAG *dag = group->members; dag; dag = dag->group_next) {
+            tasks += dag->task_count;
+        }
+        row_starts[row].runs = group->member_count * fires;
+        row_starts[row].tasks = tasks * fires;
+    }
+
+    for (int b = 0; b < block_count; b++) {
+        const ForecastBlock *block = &blocks[b];
+        struct CronTime hour = { 0, 0, block->hour, block->day, block->month, block->weekday };
+        if (cron_table_due_in_hour(&group_schedules, hour, due) == 0) continue;
+
+        uint64_t window = (~0ULL << block->first_minute) & (~0ULL >> (63 - block->last_minute));
+        for (int word = 0; word < CRON_TABLE_WORDS(rows); word++) {
+            for (uint64_t bits = due[word]; bits; bits &= bits - 1) {
+                int row = word * 64 + __builtin_ctzll(bits);
+                for (uint64_t mask = group_schedules.minutes[row] & window; mask; mask &= mask - 1) {
+                    ForecastMinute *count = &counts[block->offset + __builtin_ctzll(mask) - block->first_minute];
+                    count->runs += row_starts[row].runs;
+                    count->tasks += row_starts[row].tasks;
+                }
+            }
+        }
+    }
+    pthread_mutex_unlock(&dag_list_mutex);
+
+    free(due);
+    free(row_starts);
+    free(blocks);
+    return 0;
+}
+
+// Sparse histogram for /api/schedule/forecast: only minutes with starts are
+// listed, as [minutes from start, runs, tasks]
+char* get_schedule_forecast_json(int hours) {
+    int minutes = hours * 60;
+    time_t start = (clock_now() / 60 + 1) * 60;
+
+    ForecastMinute *counts = malloc(minutes * sizeof(ForecastMinute));
+    if (!counts) return NULL;
+    if (schedule_forecast(start, minutes, counts) != 0) {
+        free(counts);
+        return NULL;
+    }
+
+    long total_runs = 0;
+    long total_tasks = 0;
+    int peak = 0;
+    int busy_minutes = 0;
+    for (int i = 0; i < minutes; i++) {
+        if (counts[i].runs == 0) continue;
+        total_runs += counts[i].runs;
+        total_tasks += counts[i].tasks;
+        if (counts[i].runs > counts[peak].runs) peak = i;
+        busy_minutes++;
+    }
+
+    // Every entry fits in 40 bytes, the header in 256
+    size_t buffer_size = 256 + (size_t)busy_minutes * 40;
+    char *json_result = malloc(buffer_size);
+    if (!json_result) {
+        free(counts);
+        return NULL;
+    }
+
+    int pos = snprintf(json_result, buffer_size,
+                       "{\"start\":%ld,\"hours\":%d,\"total_runs\":%ld,\"total_tasks\":%ld,"
+                       "\"peak\":{\"minute\":%d,\"runs\":%d,\"tasks\":%d},\"minutes\":[",
+                       (long)start, hours, total_runs, total_tasks,
+                       peak, counts[peak].runs, counts[peak].tasks);
+
+    int first_entry = 1;
+    for (int i = 0; i < minutes; i++) {
+        if (counts[i].runs == 0) continue;
+        pos += snprintf(json_result + pos, buffer_size - pos, "%s[%d,%d,%d]",
+                        first_entry ? "" : ",", i, counts[i].runs, counts[i].tasks);
+        first_entry = 0;
+    }
+    snprintf(json_result + pos, buffer_size - pos, "]}");
+
+    free(counts);
+    return json_result;
+}
+
+// One run as a state machine on the shared executor: the first step records
+// the run and starts its root tasks, every later step takes the tasks that
+// finished and starts what they released. Between steps a run holds no
+// thread, its finished tasks post it again. A failed task with retries left
+// waits on an executor timer, which posts the run when the next attempt is
+// due. A task that ends for good settles its dependents by their trigger
+// rules, a failure only skips what can't run without it and every other
+// branch goes on. The arrays are indexed like plan->tasks.
+typedef enum {
+    TASK_PENDING,          // its trigger rule isn't decided yet
+    TASK_QUEUED,           // ready, running or waiting for a retry
+    TASK_SUCCEEDED,
+    TASK_FAILED,
+    TASK_SKIPPED
+} TaskOutcome;
+
+typedef struct DAGRun {
+    ExecutorWork work;
+    TaskCompletions completions;
+    sqlite3 *db;
+    CompiledDAG *plan;     // referenced until the run ends
+    long dispatch_delay_ms;
+    int started;
+    char *execution_id;
+    char *resumed_from;    // execution a resumed run takes successes from, NULL otherwise
+    char *reused;          // tasks it took as succeeded, one flag per task
+    int execution_db_id;
+    int running;           // tasks running or with cache work on the file thread
+    int retrying;          // tasks waiting on a timer for their next attempt
+    int clock_attached;    // counts as a clock user, dropped while only timers are left
+    int completed_tasks;
+    int failed_tasks;
+    int skipped_tasks;
+    int cancelled_tasks;   // stopped or never started because of a cancel
+    int *waiting;          // dependencies that haven't ended yet
+    int *failed_upstream;  // dependencies that failed
+    int *skipped_upstream; // dependencies that were skipped
+    int *outcome;          // TaskOutcome of each task
+    int *task_exec_ids;    // task_executions row of each started task
+    int *attempts;         // attempts started of each task
+    int *settling;         // work stack of settle_task
+    char *cache_keys;      // task cache key of each task's attempt, NULL when no task declares inputs
+    int *ready;            // max-heap of tasks with nothing left to wait for
+    int ready_count;
+    long long *priority;   // the plan's path lengths when the run started
+    struct DAGRunSlots *slots;  // holds one of them, NULL once released
+    struct DAGRun *slot_next;   // next active run of the same DAG
+    struct DAGRun *launch_next;
+} DAGRun;
+
+// A scheduled start waiting for a run slot of its DAG
+typedef struct QueuedRun {
+    CompiledDAG *plan;     // referenced while queued
+    long dispatch_delay_ms;
+    long long queued_ms;
+} QueuedRun;
+
+// Active and queued runs of one DAG, what max_active_runs is enforced on.
+// Kept by DAG id rather than on the DAG so reloads don't lose them, an entry
+// only exists while the DAG has runs active or queued. Guarded by
+// run_slots_mutex, taken after dag_list_mutex when both are needed.
+typedef struct DAGRunSlots {
+    int dag_id;
+    int max_active_runs;   // the DAG's, refreshed on every start and edit
+    int active;
+    DAGRun *runs;          // the active ones, for cancel_previous
+    QueuedRun queue[DAG_RUN_QUEUE_CAPACITY];
+    int queue_head;
+    int queue_count;
+    struct DAGRunSlots *next;
+} DAGRunSlots;
+
+#define RUN_SLOT_BUCKETS 256
+
+static DAGRunSlots *run_slots[RUN_SLOT_BUCKETS];
+static pthread_mutex_t run_slots_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static DAGRunSlots* find_run_slots_locked(int dag_id, int create) {
+    DAGRunSlots **bucket = &run_slots[(unsigned int)dag_id % RUN_SLOT_BUCKETS];
+    for (DAGRunSlots *slots = *bucket; slots; slots = slots->next) {
+        if (slots->dag_id == dag_id) return slots;
+    }
+    if (!create) return NULL;
+
+    DAGRunSlots *slots = calloc(1, sizeof(DAGRunSlots));
+    if (!slots) {
+        log_message("Failed to allocate run slots of DAG %d\n", dag_id);
+        return NULL;
+    }
+    slots->dag_id = dag_id;
+    slots->next = *bucket;
+    *bucket = slots;
+    return slots;
+}
+
+static void drop_run_slots_if_idle_locked(DAGRunSlots *slots) {
+    if (slots->active > 0 || slots->queue_count > 0) return;
+
+    DAGRunSlots **link = &run_slots[(unsigned int)slots->dag_id % RUN_SLOT_BUCKETS];
+    while (*link != slots) {
+        link = &(*link)->next;
+    }
+    *link = slots->next;
+    free(slots);
+}
+
+static void join_run_slots_locked(DAGRun *run, DAGRunSlots *slots) {
+    run->slots = slots;
+    run->slot_next = slots->runs;
+    slots->runs = run;
+    slots->active++;
+}
+
+static void leave_run_slots_locked(DAGRun *run) {
+    DAGRunSlots *slots = run->slots;
+    DAGRun **link = &slots->runs;
+    while (*link != run) {
+        link = &(*link)->slot_next;
+    }
+    *link = run->slot_next;
+    slots->active--;
+    run->slots = NULL;
+}
+
+static void drop_queued_runs_locked(DAGRunSlots *slots) {
+    while (slots->queue_count > 0) {
+        dag_plan_release(slots->queue[slots->queue_head].plan);
+        slots->queue_head = (slots->queue_head + 1) % DAG_RUN_QUEUE_CAPACITY;
+        slots->queue_count--;
+    }
+}
+
+static int run_cancelled(DAGRun *run) {
+    return __atomic_load_n(&run->completions.cancelled, __ATOMIC_ACQUIRE);
+}
+
+// The runs keep their slots until their tasks have stopped
+static void cancel_active_runs_locked(DAGRunSlots *slots) {
+    for (DAGRun *run = slots->runs; run; run = run->slot_next) {
+        if (!run_cancelled(run)) {
+            task_executor_cancel(&run->completions);
+        }
+    }
+}
+
+// The longer remaining path goes first, ties in id order
+static int ready_before(const DAGRun *run, int a, int b) {
+    if (run->priority[a] != run->priority[b]) return run->priority[a] > run->priority[b];
+    return a < b;
+}
+
+static void ready_push(DAGRun *run, int index) {
+    int position = run->ready_count++;
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!ready_before(run, index, run->ready[parent])) break;
+        run->ready[position] = run->ready[parent];
+        position = parent;
+    }
+    run->ready[position] = index;
+}
+
+static int ready_pop(DAGRun *run) {
+    int top = run->ready[0];
+    int last = run->ready[--run->ready_count];
+    int position = 0;
+    for (;;) {
+        int child = 2 * position + 1;
+        if (child >= run->ready_count) break;
+        if (child + 1 < run->ready_count && ready_before(run, run->ready[child + 1], run->ready[child])) child++;
+        if (!ready_before(run, run->ready[child], last)) break;
+        run->ready[position] = run->ready[child];
+        position = child;
+    }
+    run->ready[position] = last;
+    return top;
+}
+
+// Cache work of a task, on the executor's file thread. The job's tag is the
+// task's index and its arg the run, which waits for the job to come back.
+
+// exit_code 0 when the task's inputs are unchanged since a success and its
+// output was restored. The key of a miss is kept for storing the result, an
+// empty one leaves the task uncached.
+static void look_up_cached_result(TaskJob *job) {
+    const DAGRun *run = job->arg;
+    const CompiledTask *task = &run->plan->tasks[job->tag];
+    char *key = run->cache_keys + job->tag * TASK_CACHE_KEY_SIZE;
+    if (task_cache_key(task->task_execution, task->inputs, key) != 0) {
+        key[0] = '\0';
+    } else if (task_cache_restore(key, task->output)) {
+        job->exit_code = 0;
+    }
+}
+
+static void store_cached_result(TaskJob *job) {
+    const DAGRun *run = job->arg;
+    job->exit_code = task_cache_store(run->cache_keys + job->tag * TASK_CACHE_KEY_SIZE,
+                                      run->plan->tasks[job->tag].output);
+}
+
+// Records the task as started and hands it to the executor, tagged with its
+// index. Returns -1 when it couldn't be queued.
+static int spawn_task(DAGRun *run, int index) {
+    CompiledTask *task = &run->plan->tasks[index];
+
+    // Create task execution record, one per attempt
+    TaskExecution task_exec = {0};
+    task_exec.dag_execution_id = run->execution_db_id;
+    task_exec.task_id = task->id;
+    strncpy(task_exec.task_name, task->task_name, MAX_TASK_NAME_LENGTH - 1);
+    task_exec.status = EXECUTION_STATUS_RUNNING;
+    task_exec.attempt = ++run->attempts[index];
+    task_exec.started_at = clock_now();
+
+    run->task_exec_ids[index] = insert_task_execution_db(run->db, &task_exec);
+
+    log_message("Executing task: %s (ID: %d, attempt %d) in DAG: %s\n",
+               task->task_name, task->id, task_exec.attempt, run->plan->name);
+
+    // Log task status
+    log_dag_task_status(run->db, task->id, run->plan->dag_id, run->execution_db_id,
+                       "STARTED", task->task_execution);
+
+    return task_executor_spawn(&run->completions, index, task->task_execution, task->pool[0] ? task->pool : NULL,
+                               run->plan->dag_id, task->timeout_seconds);
+}
+
+// A task with inputs first looks for its result in the cache and only
+// spawns on a miss. Returns -1 when it couldn't be queued.
+static int start_task(DAGRun *run, int index) {
+    if (run->plan->tasks[index].inputs &&
+        task_executor_call(&run->completions, index, look_up_cached_result, run) == 0) {
+        return 0;
+    }
+    return spawn_task(run, index);
+}
+
+// Wait before the attempt after `attempt`: the task's delay, times its
+// backoff for every retry already made, capped
+static long retry_delay_ms(const CompiledTask *task, int attempt) {
+    double cap_ms = task->max_retry_delay_seconds * 1000.0;
+    double delay_ms = task->retry_delay_seconds * 1000.0;
+    for (int i = 1; i < attempt && delay_ms < cap_ms; i++) {
+        delay_ms *= task->retry_backoff;
+    }
+    return (long)(delay_ms < cap_ms ? delay_ms : cap_ms);
+}
+
+// Sets a timer for the next attempt of a failed task if it has retries left.
+// The failed attempt keeps its row, the next one gets its own when it
+// starts. Returns -1 when the task fails for good.
+static int schedule_retry(DAGRun *run, int index, const char *outcome, long duration_ms) {
+    CompiledDAG *plan = run->plan;
+    const CompiledTask *task = &plan->tasks[index];
+    int attempt = run->attempts[index];
+    if (attempt > task->retries) return -1;
+
+    long delay_ms = retry_delay_ms(task, attempt);
+    if (task_executor_deliver_after(&run->completions, index, delay_ms) != 0) return -1;
+    run->retrying++;
+
+    char message[128];
+    snprintf(message, sizeof(message), "Attempt %d of %d %s, retrying in %ld ms",
+             attempt, task->retries + 1, outcome, delay_ms);
+    update_task_execution_status_db(run->db, run->task_exec_ids[index], EXECUTION_STATUS_FAILED, message,
+                                    duration_ms);
+    log_dag_task_status(run->db, task->id, plan->dag_id, run->execution_db_id, "RETRYING", message);
+    log_message("Task %s: %s\n", task->task_name, message);
+    return 0;
+}
+
+// A task that never started, the row of its next attempt or its first
+static void record_unstarted_task(DAGRun *run, int index, ExecutionStatus status, const char *message) {
+    CompiledTask *task = &run->plan->tasks[index];
+    TaskExecution task_exec = {0};
+    task_exec.dag_execution_id = run->execution_db_id;
+    task_exec.task_id = task->id;
+    strncpy(task_exec.task_name, task->task_name, MAX_TASK_NAME_LENGTH - 1);
+    task_exec.status = status;
+    task_exec.attempt = run->attempts[index] + 1;
+
+    int id = insert_task_execution_db(run->db, &task_exec);
+    if (id >= 0) {
+        update_task_execution_status_db(run->db, id, status, message, -1);
+    }
+}
+
+// Cancelled while waiting to start, the attempt it waited for never starts
+static void cancel_unstarted_task(DAGRun *run, int index) {
+    record_unstarted_task(run, index, EXECUTION_STATUS_CANCELLED, "Run cancelled before it started");
+    run->outcome[index] = TASK_FAILED;
+    run->cancelled_tasks++;
+}
+
+// 1 when the task can start given how its dependencies ended so far, -1 when
+// its rule can't be met any more, 0 while it depends on the ones still open
+static int trigger_decision(const CompiledTask *task, int open, int failed, int skipped) {
+    switch (task->trigger_rule) {
+        case TRIGGER_RULE_ALL_DONE:
+            return open == 0 ? 1 : 0;
+        case TRIGGER_RULE_ONE_FAILED:
+            if (failed > 0) return 1;
+            return open == 0 ? -1 : 0;
+        case TRIGGER_RULE_NONE_FAILED:
+            if (failed > 0) return -1;
+            return open == 0 ? 1 : 0;
+        case TRIGGER_RULE_ALL_SUCCESS:
+        default:
+            if (failed > 0 || skipped > 0) return -1;
+            return open == 0 ? 1 : 0;
+    }
+}
+
+// Queues or skips a pending task once its rule is decided, skipped tasks go
+// on the settling stack so their own dependents see them
+static void decide_task(DAGRun *run, int index, int *stack_size) {
+    CompiledTask *task = &run->plan->tasks[index];
+    int decision = trigger_decision(task, run->waiting[index], run->failed_upstream[index],
+                                    run->skipped_upstream[index]);
+    if (decision > 0) {
+        run->outcome[index] = TASK_QUEUED;
+        ready_push(run, index);
+    } else if (decision < 0) {
+        char message[128];
+        snprintf(message, sizeof(message), "Skipped, trigger rule %s can't be met",
+                 trigger_rule_to_string(task->trigger_rule));
+        run->outcome[index] = TASK_SKIPPED;
+        run->skipped_tasks++;
+        record_unstarted_task(run, index, EXECUTION_STATUS_SKIPPED, message);
+        log_dag_task_status(run->db, task->id, run->plan->dag_id, run->execution_db_id, "SKIPPED", message);
+        log_message("Task %s: %s\n", task->task_name, message);
+        run->settling[(*stack_size)++] = index;
+    }
+}
+
+// The task ended for good: its dependents count how, and those whose rule is
+// decided now are queued or skipped, skips carrying on down their branch.
+// A task only leaves TASK_PENDING once, so the stack never holds more than
+// every task.
+static void settle_task(DAGRun *run, int index, TaskOutcome outcome) {
+    CompiledDAG *plan = run->plan;
+    int stack_size = 0;
+    run->outcome[index] = outcome;
+    run->settling[stack_size++] = index;
+
+    while (stack_size > 0) {
+        int settled = run->settling[--stack_size];
+        for (int edge = plan->dependent_offsets[settled]; edge < plan->dependent_offsets[settled + 1]; edge++) {
+            int dependent = plan->dependents[edge];
+            run->waiting[dependent]--;
+            if (run->outcome[settled] == TASK_FAILED) run->failed_upstream[dependent]++;
+            if (run->outcome[settled] == TASK_SKIPPED) run->skipped_upstream[dependent]++;
+            if (run->outcome[dependent] == TASK_PENDING) decide_task(run, dependent, &stack_size);
+        }
+    }
+}
+
+// A task served from the cache succeeded without running, no duration sample
+static void record_cached_result(DAGRun *run, int index) {
+    CompiledDAG *plan = run->plan;
+    const CompiledTask *task = &plan->tasks[index];
+    record_unstarted_task(run, index, EXECUTION_STATUS_CACHED, "Result restored from the task cache");
+    log_dag_task_status(run->db, task->id, plan->dag_id, run->execution_db_id, "CACHED", task->output);
+    log_message("Task %s served from the task cache\n", task->task_name);
+    run->completed_tasks++;
+    settle_task(run, index, TASK_SUCCEEDED);
+}
+
+// Stores how a started task ended and counts it. On success it adds the
+// duration to the plan's history, a failure with retries left waits for its
+// next attempt. Either way for good settles its dependents, a success with a
+// cache key only once its result is stored since they may change its output.
+static void record_task_result(DAGRun *run, int index, int exit_code, int timed_out, long duration_ms) {
+    CompiledDAG *plan = run->plan;
+    const CompiledTask *task = &plan->tasks[index];
+
+    if (exit_code == 0) {
+        dag_plan_record_duration(plan, index, duration_ms);
+        update_task_execution_status_db(run->db, run->task_exec_ids[index], EXECUTION_STATUS_SUCCESS, NULL,
+                                        duration_ms);
+        log_dag_task_status(run->db, task->id, plan->dag_id, run->execution_db_id,
+                           "COMPLETED", "Task completed successfully");
+        log_message("Task %s completed successfully\n", task->task_name);
+        run->completed_tasks++;
+        if (task->inputs && run->cache_keys[index * TASK_CACHE_KEY_SIZE] &&
+            task_executor_call(&run->completions, index, store_cached_result, run) == 0) {
+            run->running++;
+            return;
+        }
+        settle_task(run, index, TASK_SUCCEEDED);
+        return;
+    }
+
+    if (run_cancelled(run)) {
+        update_task_execution_status_db(run->db, run->task_exec_ids[index], EXECUTION_STATUS_CANCELLED,
+                                       "Run cancelled", duration_ms);
+        log_dag_task_status(run->db, task->id, plan->dag_id, run->execution_db_id,
+                           "CANCELLED", "Run cancelled");
+        log_message("Task %s cancelled\n", task->task_name);
+        // Nothing starts after a cancel, its dependents are left pending
+        run->outcome[index] = TASK_FAILED;
+        run->cancelled_tasks++;
+        return;
+    }
+
+    if (schedule_retry(run, index, timed_out ? "timed out" : "failed", duration_ms) == 0) return;
+
+    char message[64] = "Task execution failed";
+    if (timed_out) snprintf(message, sizeof(message), "Task timed out after %d s", task->timeout_seconds);
+    update_task_execution_status_db(run->db, run->task_exec_ids[index], EXECUTION_STATUS_FAILED,
+                                   message, duration_ms);
+    log_dag_task_status(run->db, task->id, plan->dag_id, run->execution_db_id, "FAILED", message);
+    log_message("Task %s: %s\n", task->task_name, message);
+    run->failed_tasks++;
+    settle_task(run, index, TASK_FAILED);
+}
+
+// Records the run and queues its root tasks. Returns -1 when the run can't
+// go ahead, nothing has to be undone then.
+static int begin_run(DAGRun *run) {
+    CompiledDAG *plan = run->plan;
+
+    log_message("Starting execution of DAG: %s\n", plan->name);
     
-    log_message("Starting execution of DAG: %s\n", dag->name);
-    
-    // Validate DAG dependencies before execution
-    if (!validate_dag_dependencies(dag)) {
-        log_message("DAG %s has invalid dependencies, skipping execution\n", dag->name);
+    // Dependencies were validated when the DAG was compiled
+    if (!plan->valid) {
+        log_message("DAG %s has invalid dependencies (%s), skipping execution\n", plan->name,
+                    plan->error ? plan->error : "unknown");
         return -1;
     }
     
-    // Generate unique execution ID
-    char *execution_id = generate_execution_id(dag->id);
-    if (!execution_id) {
-        log_message("Failed to generate execution ID for DAG %s\n", dag->name);
+    // Per-task counters of this run, in one block
+    int total_tasks = plan->task_count;
+    int *state = calloc(8 * (total_tasks > 0 ? total_tasks : 1), sizeof(int));
+    long long *priority = malloc((total_tasks > 0 ? total_tasks : 1) * sizeof(long long));
+    int cached = 0;
+    for (int i = 0; i < total_tasks; i++) {
+        cached |= plan->tasks[i].inputs != NULL;
+    }
+    char *cache_keys = cached ? calloc(total_tasks, TASK_CACHE_KEY_SIZE) : NULL;
+    if (!state || !priority || (cached && !cache_keys)) {
+        log_message("Failed to allocate run state for DAG %s\n", plan->name);
+        free(state);
+        free(priority);
+        free(cache_keys);
         return -1;
     }
     
     // Start DAG execution record
-    int dag_execution_db_id = start_dag_execution(db, dag->id, execution_id);
-    if (dag_execution_db_id < 0) {
-        log_message("Failed to start DAG execution record for %s\n", dag->name);
-        free(execution_id);
+    run->execution_db_id = start_dag_execution(run->db, plan->dag_id, run->execution_id, run->dispatch_delay_ms);
+    if (run->execution_db_id < 0) {
+        log_message("Failed to start DAG execution record for %s\n", plan->name);
+        free(state);
+        free(priority);
+        free(cache_keys);
         return -1;
     }
     
-    // Create execution queue based on dependencies
-    ExecutionQueue *queue = create_execution_queue(dag);
-    if (!queue) {
-        log_message("Failed to create execution queue for DAG %s\n", dag->name);
-        free(execution_id);
+    // Durations recorded during the run reorder later runs, this one keeps
+    // the priorities it started with so its heap stays consistent
+    run->waiting = state;
+    run->task_exec_ids = state + total_tasks;
+    run->ready = state + 2 * total_tasks;
+    run->attempts = state + 3 * total_tasks;
+    run->failed_upstream = state + 4 * total_tasks;
+    run->skipped_upstream = state + 5 * total_tasks;
+    run->outcome = state + 6 * total_tasks;
+    run->settling = state + 7 * total_tasks;
+    run->priority = priority;
+    run->cache_keys = cache_keys;
+    dag_plan_copy_priorities(plan, priority);
+    memcpy(run->waiting, plan->indegree, total_tasks * sizeof(int));
+
+    // A resumed run keeps the successes whose dependencies all kept theirs,
+    // every other task and everything downstream of it runs again
+    if (run->reused) {
+        for (int k = 0; k < total_tasks; k++) {
+            int i = plan->order[k];
+            for (int edge = plan->dependency_offsets[i]; edge < plan->dependency_offsets[i + 1]; edge++) {
+                if (!run->reused[plan->dependencies[edge]]) run->reused[i] = 0;
+            }
+            if (run->reused[i]) run->outcome[i] = TASK_SUCCEEDED;
+        }
+
+        char message[128];
+        snprintf(message, sizeof(message), "Succeeded in run %s", run->resumed_from);
+        for (int i = 0; i < total_tasks; i++) {
+            if (!run->reused[i]) continue;
+            record_unstarted_task(run, i, EXECUTION_STATUS_SUCCESS, message);
+            run->completed_tasks++;
+            settle_task(run, i, TASK_SUCCEEDED);
+        }
+        log_message("Run %s resumes %s, %d of %d tasks already succeeded\n", run->execution_id,
+                    run->resumed_from, run->completed_tasks, total_tasks);
+    }
+
+    // Roots are decided by their rule alone, one_failed ones are skipped
+    for (int i = 0; i < total_tasks; i++) {
+        if (plan->indegree[i] != 0 || run->outcome[i] != TASK_PENDING) continue;
+        int stack_size = 0;
+        decide_task(run, i, &stack_size);
+        if (stack_size > 0) settle_task(run, i, TASK_SKIPPED);
+    }
+    return 0;
+}
+
+static void advance_run(void *arg);
+static void release_run(DAGRun *run);
+
+// Takes over the caller's reference to plan, releasing it on failure
+static DAGRun* new_dag_run(sqlite3 *db, CompiledDAG *plan, long dispatch_delay_ms) {
+    DAGRun *run = calloc(1, sizeof(DAGRun));
+    if (!run) {
+        log_message("Failed to allocate run of DAG %s\n", plan->name);
+        dag_plan_release(plan);
+        return NULL;
+    }
+
+    // Generated up front, cancel_dag_run looks runs up by it
+    run->execution_id = generate_execution_id(plan->dag_id);
+    if (!run->execution_id) {
+        log_message("Failed to generate execution ID for DAG %s\n", plan->name);
+        dag_plan_release(plan);
+        free(run);
+        return NULL;
+    }
+
+    run->work.run = advance_run;
+    run->work.arg = run;
+    task_completions_init(&run->completions, &run->work);
+    run->db = db;
+    run->plan = plan;
+    run->dispatch_delay_ms = dispatch_delay_ms;
+    return run;
+}
+
+// Queues the run on the executor. It counts as a clock user until it ends,
+// so virtual time waits for it. Call without run_slots_mutex.
+static int launch_dag_run(DAGRun *run) {
+    clock_source_attach();
+    run->clock_attached = 1;
+    if (task_executor_post(&run->work) != 0) {
+        log_message("Failed to queue run of DAG %s\n", run->plan->name);
+        release_run(run);
         return -1;
     }
-    
-    // Execute tasks based on dependency order
-    int total_tasks = dag->task_count;
-    int completed_tasks = 0;
-    int failed_tasks = 0;
-    
-    while (completed_tasks + failed_tasks < total_tasks) {
-        ExecutionQueue *ready_tasks = get_ready_tasks(queue);
-        
-        if (!ready_tasks) {
-            // Check if we're deadlocked (no ready tasks but not all completed)
-            log_message("No ready tasks found for DAG %s, possible deadlock\n", dag->name);
-            break;
-        }
-        
-        // Execute all ready tasks in parallel
-        ExecutionQueue *current_ready = ready_tasks;
-        while (current_ready) {
-            DAGTask *task = current_ready->task;
-            
-            // Create task execution record
-            TaskExecution task_exec = {0};
-            task_exec.dag_execution_id = dag_execution_db_id;
-            task_exec.task_id = task->id;
-            strncpy(task_exec.task_name, task->task_name, MAX_TASK_NAME_LENGTH - 1);
-            task_exec.status = EXECUTION_STATUS_RUNNING;
-            task_exec.started_at = time(NULL);
-            
-            int task_exec_id = insert_task_execution_db(db, &task_exec);
-            
-            log_message("Executing task: %s (ID: %d) in DAG: %s\n", 
-                       task->task_name, task->id, dag->name);
-            
-            // Log task status
-            log_dag_task_status(db, task->id, dag->id, dag_execution_db_id, 
-                               "STARTED", task->task_execution);
-            
-            // Execute the task (spawn worker thread)
-            ThreadParams *params = malloc(sizeof(ThreadParams));
-            if (params) {
-                params->taskId = task->id;
-                strncpy(params->taskName, task->task_name, sizeof(params->taskName) - 1);
-                strncpy(params->taskExecution, task->task_execution, sizeof(params->taskExecution) - 1);
-                
-                // For now, execute synchronously for dependency management
-                // In a production system, you'd want async execution with proper coordination
-                int execution_result = execute_task_sync(params);
-                
-                if (execution_result == 0) {
-                    // Task succeeded
-                    mark_task_completed(queue, task->id);
-                    update_task_execution_status_db(db, task_exec_id, EXECUTION_STATUS_SUCCESS, NULL);
-                    log_dag_task_status(db, task->id, dag->id, dag_execution_db_id, 
-                                       "COMPLETED", "Task completed successfully");
-                    completed_tasks++;
-                    log_message("Task %s completed successfully\n", task->task_name);
-                } else {
-                    // Task failed
-                    update_task_execution_status_db(db, task_exec_id, EXECUTION_STATUS_FAILED, 
-                                                   "Task execution failed");
-                    log_dag_task_status(db, task->id, dag->id, dag_execution_db_id, 
-                                       "FAILED", "Task execution failed");
-                    failed_tasks++;
-                    log_message("Task %s failed\n", task->task_name);
-                }
-                
-                free(params);
+    return 0;
+}
+
+static void launch_dag_runs(DAGRun *runs) {
+    while (runs) {
+        DAGRun *next = runs->launch_next;
+        launch_dag_run(runs);
+        runs = next;
+    }
+}
+
+// Moves queued runs into the free slots of the DAG, oldest first. The runs
+// come back chained by launch_next, to launch once run_slots_mutex is released.
+static DAGRun* admit_queued_runs_locked(sqlite3 *db, DAGRunSlots *slots) {
+    DAGRun *admitted = NULL;
+    DAGRun **tail = &admitted;
+    long long now_ms = clock_elapsed_ms();
+
+    while (slots->queue_count > 0 && (slots->max_active_runs <= 0 || slots->active < slots->max_active_runs)) {
+        QueuedRun entry = slots->queue[slots->queue_head];
+        slots->queue_head = (slots->queue_head + 1) % DAG_RUN_QUEUE_CAPACITY;
+        slots->queue_count--;
+
+        // The time in the run queue counts as dispatch delay as well
+        DAGRun *run = new_dag_run(db, entry.plan, entry.dispatch_delay_ms + (long)(now_ms - entry.queued_ms));
+        if (!run) continue;
+        join_run_slots_locked(run, slots);
+        *tail = run;
+        tail = &run->launch_next;
+    }
+    return admitted;
+}
+
+// Queued runs switch to the reloaded plan, a raised limit admits them
+static DAGRun* sync_run_slots_locked(sqlite3 *db, DAGRunSlots *slots, const DAG *dag) {
+    if (!dag || !dag->plan) {
+        drop_queued_runs_locked(slots);
+        return NULL;
+    }
+
+    slots->max_active_runs = dag->max_active_runs;
+    for (int i = 0; i < slots->queue_count; i++) {
+        QueuedRun *entry = &slots->queue[(slots->queue_head + i) % DAG_RUN_QUEUE_CAPACITY];
+        dag_plan_release(entry->plan);
+        entry->plan = dag_plan_acquire(dag->plan);
+    }
+    return admit_queued_runs_locked(db, slots);
+}
+
+// Both are called with dag_list_mutex held
+static void sync_run_slots(sqlite3 *db, int dag_id, const DAG *dag) {
+    DAGRun *admitted = NULL;
+
+    pthread_mutex_lock(&run_slots_mutex);
+    DAGRunSlots *slots = find_run_slots_locked(dag_id, 0);
+    if (slots) {
+        admitted = sync_run_slots_locked(db, slots, dag);
+        drop_run_slots_if_idle_locked(slots);
+    }
+    pthread_mutex_unlock(&run_slots_mutex);
+
+    launch_dag_runs(admitted);
+}
+
+static void sync_all_run_slots(sqlite3 *db) {
+    DAGRun *admitted = NULL;
+    DAGRun **tail = &admitted;
+
+    pthread_mutex_lock(&run_slots_mutex);
+    for (int bucket = 0; bucket < RUN_SLOT_BUCKETS; bucket++) {
+        DAGRunSlots *slots = run_slots[bucket];
+        while (slots) {
+            DAGRunSlots *next = slots->next;
+            const DAG *dag = dag_list_head;
+            while (dag && dag->id != slots->dag_id) {
+                dag = dag->next;
             }
-            
-            current_ready = current_ready->next;
-        }
-        
-        // Free ready tasks list
-        ExecutionQueue *temp = ready_tasks;
-        while (temp) {
-            ExecutionQueue *next = temp->next;
-            free(temp);
-            temp = next;
+            *tail = sync_run_slots_locked(db, slots, dag);
+            while (*tail) {
+                tail = &(*tail)->launch_next;
+            }
+            drop_run_slots_if_idle_locked(slots);
+            slots = next;
         }
-        
-        // If any task failed, decide whether to continue or abort
-        if (failed_tasks > 0) {
-            log_message("DAG %s has %d failed tasks, aborting execution\n", dag->name, failed_tasks);
-            break;
+    }
+    pthread_mutex_unlock(&run_slots_mutex);
+
+    launch_dag_runs(admitted);
+}
+
+// Frees the run and passes its slot on to the DAG's next queued run
+static void release_run(DAGRun *run) {
+    DAGRun *admitted = NULL;
+
+    if (run->slots) {
+        pthread_mutex_lock(&run_slots_mutex);
+        DAGRunSlots *slots = run->slots;
+        leave_run_slots_locked(run);
+        admitted = admit_queued_runs_locked(run->db, slots);
+        drop_run_slots_if_idle_locked(slots);
+        pthread_mutex_unlock(&run_slots_mutex);
+    }
+
+    int clock_attached = run->clock_attached;
+    task_completions_destroy(&run->completions);
+    free(run->waiting);
+    free(run->priority);
+    free(run->execution_id);
+    free(run->resumed_from);
+    free(run->reused);
+    free(run->cache_keys);
+    dag_plan_release(run->plan);
+    free(run);
+    // Before detaching, so a virtual clock doesn't jump past the next run
+    launch_dag_runs(admitted);
+    if (clock_attached) clock_source_detach();
+}
+
+// Nothing is running or can start any more
+static void finish_run(DAGRun *run) {
+    CompiledDAG *plan = run->plan;
+
+    // A cancel that came after the last task ended changes nothing
+    int ended = run->completed_tasks + run->failed_tasks + run->skipped_tasks;
+    int cancelled = run_cancelled(run) && ended < plan->task_count;
+    if (cancelled) {
+        log_message("DAG %s run %s was cancelled\n", plan->name, run->execution_id);
+        // Nothing runs any more, so a queued task never got to start, even
+        // one whose retry timer fired just before the cancel
+        for (int i = 0; i < plan->task_count; i++) {
+            if (run->outcome[i] == TASK_PENDING || run->outcome[i] == TASK_QUEUED) {
+                record_unstarted_task(run, i, EXECUTION_STATUS_CANCELLED, "Run cancelled before it started");
+                run->cancelled_tasks++;
+            }
         }
-        
-        // Small delay to prevent tight loops
-        usleep(100000); // 100ms
+    } else if (run->failed_tasks > 0) {
+        log_message("DAG %s has %d failed tasks\n", plan->name, run->failed_tasks);
+    } else if (ended < plan->task_count) {
+        // Nothing running and nothing ready but tasks left over
+        log_message("No ready tasks found for DAG %s, possible deadlock\n", plan->name);
     }
     
     // Update DAG execution status
-    ExecutionStatus final_status = (failed_tasks > 0) ? EXECUTION_STATUS_FAILED : EXECUTION_STATUS_SUCCESS;
+    ExecutionStatus final_status = cancelled ? EXECUTION_STATUS_CANCELLED
+                                 : (run->failed_tasks > 0) ? EXECUTION_STATUS_FAILED : EXECUTION_STATUS_SUCCESS;
     char completion_message[256];
     snprintf(completion_message, sizeof(completion_message), 
-             "DAG execution completed: %d successful, %d failed", completed_tasks, failed_tasks);
-    
-    update_dag_execution_status_db(db, dag_execution_db_id, final_status, 
-                                  (failed_tasks > 0) ? completion_message : NULL);
+             "DAG execution %s: %d successful, %d failed, %d skipped, %d cancelled",
+             cancelled ? "cancelled" : "completed", run->completed_tasks, run->failed_tasks, run->skipped_tasks,
+             run->cancelled_tasks);
     
-    // Free execution queue
-    ExecutionQueue *temp = queue;
-    while (temp) {
-        ExecutionQueue *next = temp->next;
-        free(temp);
-        temp = next;
-    }
-    
-    free(execution_id);
+    update_dag_execution_status_db(run->db, run->execution_db_id, final_status, 
+                                  (final_status != EXECUTION_STATUS_SUCCESS) ? completion_message : NULL);
     
-    log_message("DAG %s execution completed: %d successful, %d failed\n", 
-               dag->name, completed_tasks, failed_tasks);
+    log_message("DAG %s execution %s: %d successful, %d failed, %d skipped, %d cancelled\n", plan->name,
+               cancelled ? "cancelled" : "completed", run->completed_tasks, run->failed_tasks, run->skipped_tasks,
+               run->cancelled_tasks);
     
-    return (failed_tasks > 0) ? -1 : 0;
+    release_run(run);
 }
 
-int execute_task_sync(ThreadParams *params) {
-    if (!params) return -1;
-    
-    log_message("Executing task: %s with command: %s\n", params->taskName, params->taskExecution);
-    
-    // Execute the task command
-    int result = system(params->taskExecution);
-    
-    if (result == 0) {
-        log_message("Task %s completed successfully\n", params->taskName);
-        return 0;
+// One step of a run on an executor thread
+static void advance_run(void *arg) {
+    DAGRun *run = (DAGRun*)arg;
+    CompiledDAG *plan = run->plan;
+
+    if (!run->started) {
+        run->started = 1;
+        if (begin_run(run) != 0) {
+            release_run(run);
+            return;
+        }
+    }
+
+    // Each completion releases its dependents, which are dispatched right
+    // away; the step ends once there are no completions left to take
+    for (;;) {
+        // After a cancel nothing new starts, tasks already running finish
+        while (!run_cancelled(run) && run->ready_count > 0 &&
+               (plan->max_parallel_tasks <= 0 || run->running < plan->max_parallel_tasks)) {
+            int index = ready_pop(run);
+            if (start_task(run, index) == 0) {
+                run->running++;
+            } else {
+                record_task_result(run, index, -1, 0, -1);
+            }
+        }
+
+        if (run->running == 0 && run->retrying == 0) {
+            finish_run(run);
+            return;
+        }
+
+        // Waiting for timers only, virtual time may move on to the first.
+        // A fired timer holds the clock until it is taken.
+        if (run->running == 0 && run->clock_attached) {
+            clock_source_detach();
+            run->clock_attached = 0;
+        }
+
+        // NULL hands the run over to the next task to finish
+        TaskJob *job = task_completions_take(&run->completions);
+        if (!job) return;
+
+        if (!run->clock_attached) {
+            clock_source_attach();
+            run->clock_attached = 1;
+        }
+
+        if (job->timer) {
+            clock_source_detach();
+            run->retrying--;
+            if (job->exit_code == 0 && !run_cancelled(run)) {
+                ready_push(run, job->tag);
+            } else {
+                cancel_unstarted_task(run, job->tag);
+            }
+        } else if (job->call == look_up_cached_result) {
+            run->running--;
+            if (run_cancelled(run)) {
+                cancel_unstarted_task(run, job->tag);
+            } else if (job->exit_code == 0) {
+                record_cached_result(run, job->tag);
+            } else if (spawn_task(run, job->tag) == 0) {
+                run->running++;
+            } else {
+                record_task_result(run, job->tag, -1, 0, -1);
+            }
+        } else if (job->call == store_cached_result) {
+            // Stored or not, the task succeeded
+            run->running--;
+            settle_task(run, job->tag, TASK_SUCCEEDED);
+        } else {
+            run->running--;
+            record_task_result(run, job->tag, job->exit_code, job->timed_out, job->duration_ms);
+        }
+        task_job_free(job);
+    }
+}
+
+// Manual runs always start, but take a slot so scheduled starts see them.
+// Takes over resumed_from and reused, both NULL for a fresh run.
+static int execute_dag_run(sqlite3 *db, CompiledDAG *plan, long dispatch_delay_ms, char *resumed_from,
+                           char *reused, char *execution_id) {
+    pthread_mutex_lock(&run_slots_mutex);
+    DAGRunSlots *slots = find_run_slots_locked(plan->dag_id, 1);
+    DAGRun *run = slots ? new_dag_run(db, dag_plan_acquire(plan), dispatch_delay_ms) : NULL;
+    if (run) {
+        run->resumed_from = resumed_from;
+        run->reused = reused;
+        // Copied now, the run may be gone by the time launch returns
+        snprintf(execution_id, MAX_EXECUTION_ID_LENGTH, "%s", run->execution_id);
+        join_run_slots_locked(run, slots);
     } else {
-        log_message("Task %s failed with exit code %d\n", params->taskName, result);
+        free(resumed_from);
+        free(reused);
+        if (slots) drop_run_slots_if_idle_locked(slots);
+    }
+    pthread_mutex_unlock(&run_slots_mutex);
+
+    if (!run || launch_dag_run(run) != 0) {
         return -1;
     }
+    return 0;
+}
+
+// begin_run would drop a run of an invalid plan, so none is created and no
+// execution id handed out for it
+static int check_plan_valid(const CompiledDAG *plan, char **error) {
+    if (plan->valid) return 0;
+    log_message("DAG %s has invalid dependencies (%s), not starting it\n", plan->name,
+                plan->error ? plan->error : "unknown");
+    *error = strdup(plan->error ? plan->error : "unknown");
+    return -3;
+}
+
+int execute_dag(sqlite3 *db, CompiledDAG *plan, long dispatch_delay_ms, char *execution_id, char **error) {
+    if (!plan) {
+        return -1;
+    }
+    if (check_plan_valid(plan, error) != 0) {
+        return -3;
+    }
+    return execute_dag_run(db, plan, dispatch_delay_ms, NULL, NULL, execution_id);
+}
+
+static void queue_dag_run_locked(DAGRunSlots *slots, DAG *dag, long dispatch_delay_ms) {
+    if (slots->queue_count == DAG_RUN_QUEUE_CAPACITY) {
+        log_message("Run queue of DAG %s is full, skipping this run\n", dag->name);
+        return;
+    }
+
+    int tail = (slots->queue_head + slots->queue_count) % DAG_RUN_QUEUE_CAPACITY;
+    slots->queue[tail] = (QueuedRun){ dag_plan_acquire(dag->plan), dispatch_delay_ms, clock_elapsed_ms() };
+    slots->queue_count++;
+    log_message("DAG %s has %d active runs, queued this run (%d waiting)\n", dag->name, slots->active,
+                slots->queue_count);
+}
+
+// Queues the run on the shared executor, runs don't get threads of their
+// own. Once the DAG has max_active_runs runs its overlap policy decides.
+static void start_dag_run(sqlite3 *db, DAG *dag, long dispatch_delay_ms) {
+    if (dispatch_delay_ms > 0) {
+        log_message("DAG %s starting after %ld ms in the start queue\n", dag->name, dispatch_delay_ms);
+    }
+
+    if (!dag->plan) {
+        log_message("DAG %s has no compiled plan, skipping this run\n", dag->name);
+        return;
+    }
+
+    pthread_mutex_lock(&run_slots_mutex);
+    DAGRunSlots *slots = find_run_slots_locked(dag->id, 1);
+    if (!slots) {
+        pthread_mutex_unlock(&run_slots_mutex);
+        return;
+    }
+    slots->max_active_runs = dag->max_active_runs;
+
+    DAGRun *run = NULL;
+    // Runs already queued go first
+    if (slots->queue_count == 0 && (dag->max_active_runs <= 0 || slots->active < dag->max_active_runs)) {
+        run = new_dag_run(db, dag_plan_acquire(dag->plan), dispatch_delay_ms);
+        if (run) join_run_slots_locked(run, slots);
+    } else if (dag->overlap_policy == OVERLAP_POLICY_SKIP) {
+        log_message("DAG %s already has %d active runs, skipping this run\n", dag->name, slots->active);
+    } else {
+        if (dag->overlap_policy == OVERLAP_POLICY_CANCEL_PREVIOUS) {
+            log_message("DAG %s already has %d active runs, cancelling them\n", dag->name, slots->active);
+            cancel_active_runs_locked(slots);
+            drop_queued_runs_locked(slots);
+        }
+        queue_dag_run_locked(slots, dag, dispatch_delay_ms);
+    }
+    drop_run_slots_if_idle_locked(slots);
+    pthread_mutex_unlock(&run_slots_mutex);
+
+    if (run) launch_dag_run(run);
+}
+
+int cancel_dag_run(int dag_id, const char *execution_id) {
+    int found = 0;
+    pthread_mutex_lock(&run_slots_mutex);
+    DAGRunSlots *slots = find_run_slots_locked(dag_id, 0);
+    for (DAGRun *run = slots ? slots->runs : NULL; run; run = run->slot_next) {
+        if (strcmp(run->execution_id, execution_id) != 0) continue;
+        found = 1;
+        if (!run_cancelled(run)) {
+            log_message("Cancelling run %s of DAG %d\n", execution_id, dag_id);
+            task_executor_cancel(&run->completions);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&run_slots_mutex);
+    return found ? 0 : -1;
+}
+
+// The "runs" object of /api/dag/[id]/status: the DAG's limit and policy,
+// its active runs and the queued ones oldest first. NULL when the DAG isn't loaded.
+char* get_dag_runs_json(int dag_id) {
+    pthread_mutex_lock(&dag_list_mutex);
+    const DAG *dag = dag_list_head;
+    while (dag && dag->id != dag_id) {
+        dag = dag->next;
+    }
+    if (!dag) {
+        pthread_mutex_unlock(&dag_list_mutex);
+        return NULL;
+    }
+
+    // Every queued entry fits in 64 bytes, the rest in 256
+    size_t buffer_size = 256 + DAG_RUN_QUEUE_CAPACITY * 64;
+    char *json_result = malloc(buffer_size);
+    if (!json_result) {
+        pthread_mutex_unlock(&dag_list_mutex);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&run_slots_mutex);
+    const DAGRunSlots *slots = find_run_slots_locked(dag_id, 0);
+    int pos = snprintf(json_result, buffer_size,
+                       "{\"max_active_runs\":%d,\"overlap_policy\":\"%s\",\"active\":%d,"
+                       "\"queue_capacity\":%d,\"queued\":[",
+                       dag->max_active_runs, overlap_policy_to_string(dag->overlap_policy),
+                       slots ? slots->active : 0, DAG_RUN_QUEUE_CAPACITY);
+    long long now_ms = clock_elapsed_ms();
+    for (int i = 0; slots && i < slots->queue_count; i++) {
+        const QueuedRun *entry = &slots->queue[(slots->queue_head + i) % DAG_RUN_QUEUE_CAPACITY];
+        pos += snprintf(json_result + pos, buffer_size - pos, "%s{\"waiting_ms\":%lld,\"dispatch_delay_ms\":%ld}",
+                        i == 0 ? "" : ",", now_ms - entry->queued_ms, entry->dispatch_delay_ms);
+    }
+    pthread_mutex_unlock(&run_slots_mutex);
+    pthread_mutex_unlock(&dag_list_mutex);
+
+    snprintf(json_result + pos, buffer_size - pos, "]}");
+    return json_result;
+}
+
+// Starts the run now if the budget allows, otherwise queues it behind the
+// runs already waiting
+static void request_dag_start(sqlite3 *db, DAG *dag, long long now_ms) {
+    if (dag_start_rate == 0) {
+        start_dag_run(db, dag, 0);
+        return;
+    }
+
+    refill_start_tokens(now_ms);
+    if (pending_count == 0 && start_tokens >= 1) {
+        start_tokens -= 1;
+        start_dag_run(db, dag, 0);
+        return;
+    }
+
+    if (pending_count == DAG_START_QUEUE_CAPACITY) {
+        log_message("DAG start queue full, skipping this run of %s\n", dag->name);
+        return;
+    }
+    pending_starts[(pending_head + pending_count) % DAG_START_QUEUE_CAPACITY] = (PendingStart){ dag, now_ms };
+    pending_count++;
+}
+
+static void drain_pending_starts(sqlite3 *db, long long now_ms) {
+    if (pending_count == 0) return;
+    if (dag_start_rate > 0) refill_start_tokens(now_ms);
+
+    // Runs left over from before the limit was lifted all go at once
+    while (pending_count > 0 && (dag_start_rate == 0 || start_tokens >= 1)) {
+        PendingStart entry = pending_starts[pending_head];
+        pending_head = (pending_head + 1) % DAG_START_QUEUE_CAPACITY;
+        pending_count--;
+        if (dag_start_rate > 0) start_tokens -= 1;
+        start_dag_run(db, entry.dag, (long)(now_ms - entry.queued_ms));
+    }
+}
+
+// Earliest of the next schedule fire and the next queued start, 0 if neither
+static int next_dag_deadline(struct timespec *deadline) {
+    time_t next_due = dag_queue_next_due();
+    int has_deadline = next_due != -1;
+    if (has_deadline) {
+        deadline->tv_sec = next_due;
+        deadline->tv_nsec = 0;
+    }
+
+    if (pending_count > 0) {
+        double missing = 1 - start_tokens;
+        long long wait_ms = (missing > 0 && dag_start_rate > 0) ? (long long)(missing * 1000 / dag_start_rate) + 1 : 0;
+        struct timespec start_at;
+        clock_now_precise(&start_at);
+        start_at.tv_sec += wait_ms / 1000;
+        start_at.tv_nsec += (wait_ms % 1000) * 1000000;
+        if (start_at.tv_nsec >= 1000000000) {
+            start_at.tv_sec++;
+            start_at.tv_nsec -= 1000000000;
+        }
+
+        if (!has_deadline || start_at.tv_sec < deadline->tv_sec ||
+            (start_at.tv_sec == deadline->tv_sec && start_at.tv_nsec < deadline->tv_nsec)) {
+            *deadline = start_at;
+        }
+        has_deadline = 1;
+    }
+    return has_deadline;
 }
 
 void dag_scheduler(sqlite3 *db) {
@@ -235,59 +1588,35 @@ void dag_scheduler(sqlite3 *db) {
     // Load DAGs from database
     load_dags_from_database(db);
     
+    pthread_mutex_lock(&dag_list_mutex);
+
     while (1) {
-        time_t now = time(NULL);
-        struct tm *current_time = localtime(&now);
-
-        struct CronTime cronTime = {
-            current_time->tm_min,
-            current_time->tm_hour,
-            current_time->tm_mday,
-            current_time->tm_mon + 1,  // tm_mon is 0-11, CronTime expects 1-12
-            current_time->tm_wday      // 0-6, Sunday = 0
-        };
+        // Sleep until the earliest due DAG or queued start, reloads wake us up early
+        struct timespec deadline;
+        int has_deadline = next_dag_deadline(&deadline);
+        if (!wakeup_wait(&dag_list_changed, &dag_list_mutex, has_deadline ? &deadline : NULL)) continue;
+
+        // Runs deferred earlier go before anything that becomes due now
+        long long now_ms = clock_elapsed_ms();
+        drain_pending_starts(db, now_ms);
 
-        pthread_mutex_lock(&dag_list_mutex);
-        
-        DAG *current_dag = dag_list_head;
-        while (current_dag != NULL) {
-            if (current_dag->status == DAG_STATUS_ACTIVE && 
-                is_dag_time_to_run(current_dag->cron_expression, cronTime)) {
-                
+        // Only the schedules due now are touched, the rest of the queue is left alone
+        time_t now = clock_now();
+        time_t due;
+        ScheduleGroup *group;
+        while ((group = dag_queue_pop_due(now, &due)) != NULL) {
+            for (DAG *current_dag = group->members; current_dag; current_dag = current_dag->group_next) {
                 log_message("DAG %s is scheduled to run\n", current_dag->name);
-                
-                // Execute DAG in a separate thread to allow parallel DAG execution
-                pthread_t dag_thread;
-                DAGExecutionContext *context = malloc(sizeof(DAGExecutionContext));
-                if (context) {
-                    context->db = db;
-                    context->dag = current_dag;
-                    
-                    if (pthread_create(&dag_thread, NULL, dag_execution_thread, context) != 0) {
-                        log_message("Failed to create thread for DAG %s\n", current_dag->name);
-                        free(context);
-                    } else {
-                        pthread_detach(dag_thread); // Allow thread to clean up automatically
-                    }
-                }
+                request_dag_start(db, current_dag, now_ms);
             }
-            current_dag = current_dag->next;
-        }
-        
-        pthread_mutex_unlock(&dag_list_mutex);
-        
-        // Sleep for 30 seconds before checking again
-        sleep(30);
-    }
-}
 
-void* dag_execution_thread(void *arg) {
-    DAGExecutionContext *context = (DAGExecutionContext*)arg;
-    if (context) {
-        execute_dag(context->db, context->dag);
-        free(context);
+            // If we woke up late, don't replay every missed second
+            if (due > dag_cursor) dag_cursor = due;
+            time_t next_run = cron_next_fire(group->schedule, (now - 1 > due) ? now - 1 : due);
+            if (next_run != -1) dag_queue_set(group, next_run);
+        }
+        if (now - 1 > dag_cursor) dag_cursor = now - 1;
     }
-    return NULL;
 }
 
 void reload_dags(sqlite3 *db) {
@@ -295,16 +1624,20 @@ void reload_dags(sqlite3 *db) {
     load_dags_from_database(db);
 }
 
-int trigger_dag_execution(sqlite3 *db, int dag_id) {
+int trigger_dag_execution(sqlite3 *db, int dag_id, char *execution_id, char **error) {
     pthread_mutex_lock(&dag_list_mutex);
     
     DAG *current_dag = dag_list_head;
     while (current_dag) {
         if (current_dag->id == dag_id) {
+            // The plan stays valid even if the DAG is reloaded meanwhile
+            CompiledDAG *plan = dag_plan_acquire(current_dag->plan);
             pthread_mutex_unlock(&dag_list_mutex);
             
             log_message("Manually triggering DAG %s (ID: %d)\n", current_dag->name, dag_id);
-            return execute_dag(db, current_dag);
+            int result = execute_dag(db, plan, 0, execution_id, error);
+            dag_plan_release(plan);
+            return result;
         }
         current_dag = current_dag->next;
     }
@@ -312,5 +1645,60 @@ int trigger_dag_execution(sqlite3 *db, int dag_id) {
     pthread_mutex_unlock(&dag_list_mutex);
     
     log_message("DAG with ID %d not found\n", dag_id);
-    return -1;
+    return -2;
+}
+
+static int run_is_active(int dag_id, const char *execution_id) {
+    int active = 0;
+    pthread_mutex_lock(&run_slots_mutex);
+    const DAGRunSlots *slots = find_run_slots_locked(dag_id, 0);
+    for (const DAGRun *run = slots ? slots->runs : NULL; run && !active; run = run->slot_next) {
+        active = strcmp(run->execution_id, execution_id) == 0;
+    }
+    pthread_mutex_unlock(&run_slots_mutex);
+    return active;
+}
+
+int resume_dag_execution(sqlite3 *db, int dag_id, const char *execution_id, char *resumed_execution_id,
+                         char **error) {
+    pthread_mutex_lock(&dag_list_mutex);
+    DAG *current_dag = dag_list_head;
+    while (current_dag && current_dag->id != dag_id) {
+        current_dag = current_dag->next;
+    }
+    CompiledDAG *plan = current_dag ? dag_plan_acquire(current_dag->plan) : NULL;
+    pthread_mutex_unlock(&dag_list_mutex);
+
+    if (!plan) {
+        log_message("DAG with ID %d not found\n", dag_id);
+        return -2;
+    }
+    if (check_plan_valid(plan, error) != 0) {
+        dag_plan_release(plan);
+        return -3;
+    }
+
+    // Tasks added since the earlier run have no success there and run as well
+    char *reused = calloc(plan->task_count > 0 ? plan->task_count : 1, 1);
+    char *resumed_from = strdup(execution_id);
+    if (!reused || !resumed_from) {
+        log_message("Failed to allocate resume of run %s\n", execution_id);
+        free(reused);
+        free(resumed_from);
+        dag_plan_release(plan);
+        return -1;
+    }
+
+    if (run_is_active(dag_id, execution_id) || load_succeeded_tasks_db(db, plan, execution_id, reused) < 0) {
+        log_message("DAG %s has no finished run %s to resume\n", plan->name, execution_id);
+        free(reused);
+        free(resumed_from);
+        dag_plan_release(plan);
+        return -2;
+    }
+
+    log_message("Resuming run %s of DAG %s (ID: %d)\n", execution_id, plan->name, dag_id);
+    int result = execute_dag_run(db, plan, 0, resumed_from, reused, resumed_execution_id);
+    dag_plan_release(plan);
+    return result;
 }
\ No newline at end of file
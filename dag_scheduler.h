@@ -7,20 +7,49 @@
 #include "cron.h"
 #include "thread.h"
 
-// Context structure for DAG execution threads
-typedef struct DAGExecutionContext {
-    sqlite3 *db;
-    DAG *dag;
-} DAGExecutionContext;
+// Default cap on scheduled DAG starts per second, --max-dag-starts=N overrides it (0 = no limit)
+#define DAG_START_RATE_DEFAULT 20
+// Runs waiting for start budget; further ones are skipped
+#define DAG_START_QUEUE_CAPACITY 4096
+// Scheduled runs of one DAG waiting for a max_active_runs slot; further ones are skipped
+#define DAG_RUN_QUEUE_CAPACITY 16
+
+// Longest window /api/schedule/forecast will compute
+#define SCHEDULE_FORECAST_MAX_HOURS 168
+
+// Starts predicted for one minute by schedule_forecast
+typedef struct ForecastMinute {
+    int runs;
+    int tasks;
+} ForecastMinute;
 
 // DAG Scheduler Functions
 void load_dags_from_database(sqlite3 *db);
-int is_dag_time_to_run(const char *cronExpression, struct CronTime now);
-int execute_dag(sqlite3 *db, DAG *dag);
-int execute_task_sync(ThreadParams *params);
+// Starts plan on the shared executor without waiting for it. The run's id goes
+// to execution_id, MAX_EXECUTION_ID_LENGTH bytes. Returns -3 when the plan's
+// dependencies are invalid, *error then holds why for the caller to free.
+int execute_dag(sqlite3 *db, CompiledDAG *plan, long dispatch_delay_ms, char *execution_id, char **error);
 void dag_scheduler(sqlite3 *db);
-void* dag_execution_thread(void *arg);
 void reload_dags(sqlite3 *db);
-int trigger_dag_execution(sqlite3 *db, int dag_id);
+void refresh_dag(sqlite3 *db, int dag_id);
+void set_dag_start_rate(double starts_per_second);
+int schedule_forecast(time_t start, int minutes, ForecastMinute *counts);
+char* get_schedule_forecast_json(int hours);
+char* get_dag_runs_json(int dag_id);
+// Terminates the running tasks of an active run, tasks it hasn't started are
+// recorded as cancelled. Returns -1 when the DAG has no active run with that id.
+int cancel_dag_run(int dag_id, const char *execution_id);
+// Starts a run of the DAG like execute_dag. Returns -2 when there is no such
+// DAG, -3 when its dependencies are invalid and -1 when the run couldn't be
+// started.
+int trigger_dag_execution(sqlite3 *db, int dag_id, char *execution_id, char **error);
+// Runs the DAG again taking the tasks that succeeded in its finished run
+// execution_id as done: only the ones that failed, were skipped or never
+// started run, with everything downstream of them. Starts it like
+// trigger_dag_execution, the new run's id goes to resumed_execution_id.
+// Returns -2 when the DAG has no such finished run, -3 with *error like
+// execute_dag when its dependencies are invalid.
+int resume_dag_execution(sqlite3 *db, int dag_id, const char *execution_id, char *resumed_execution_id,
+                         char **error);
 
 #endif
\ No newline at end of file
@@ -3,10 +3,12 @@
 #include <stdlib.h>
 #include <sqlite3.h>
 #include <string.h>
+#include <cjson/cJSON.h>
 #include "scheduler.h"
 #include "logger.h"
 #include "dag.h"
 #include "database.h"
+#include "task_executor.h"
 
 sqlite3* initialize_database() {
     sqlite3 *db;
@@ -72,6 +74,15 @@ sqlite3* dag_migration(sqlite3 *db){
         ErrMsg = 0;
     }
 
+    // Tasks are always loaded per DAG
+    sql = "CREATE INDEX IF NOT EXISTS idx_dag_tasks_dag_id ON dag_tasks(dag_id)";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        log_message("DAG tasks index creation error: %s\n", ErrMsg);
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
     // Create DAG executions table
     sql = "CREATE TABLE IF NOT EXISTS dag_executions ("
           "id INTEGER PRIMARY KEY AUTOINCREMENT, "
@@ -125,6 +136,146 @@ sqlite3* dag_migration(sqlite3 *db){
         ErrMsg = 0;
     }
 
+    // Milliseconds a scheduled run waited for start budget
+    sql = "ALTER TABLE dag_executions ADD COLUMN dispatch_delay_ms INTEGER DEFAULT 0";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Per-DAG cap on tasks of one run executing at once, 0 = no limit
+    sql = "ALTER TABLE dags ADD COLUMN max_parallel_tasks INTEGER DEFAULT 0";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Per-DAG cap on runs executing at once, 0 = no limit, and what a scheduled
+    // start does when the cap is reached: queue, skip or cancel_previous
+    sql = "ALTER TABLE dags ADD COLUMN max_active_runs INTEGER DEFAULT 0";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    sql = "ALTER TABLE dags ADD COLUMN overlap_policy TEXT DEFAULT 'queue'";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Wall time of each task command, weighs the task on its DAG's critical path
+    sql = "ALTER TABLE task_executions ADD COLUMN duration_ms INTEGER";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Duration history is read per task when DAGs load
+    sql = "CREATE INDEX IF NOT EXISTS idx_task_executions_task_id ON task_executions(task_id)";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        log_message("Task executions index creation error: %s\n", ErrMsg);
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Named limits on commands running at once across all DAGs, tasks name
+    // the pool they take a slot of
+    sql = "CREATE TABLE IF NOT EXISTS pools ("
+          "name TEXT PRIMARY KEY, "
+          "slots INTEGER NOT NULL, "
+          "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+          ")";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        log_message("Pools table creation error: %s\n", ErrMsg);
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    sql = "ALTER TABLE dag_tasks ADD COLUMN pool TEXT";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Retries of a failed task: how many, the first delay, the factor each
+    // later delay grows by and its cap
+    sql = "ALTER TABLE dag_tasks ADD COLUMN retries INTEGER DEFAULT 0";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    sql = "ALTER TABLE dag_tasks ADD COLUMN retry_delay_seconds INTEGER DEFAULT 30";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    sql = "ALTER TABLE dag_tasks ADD COLUMN retry_backoff REAL DEFAULT 2";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    sql = "ALTER TABLE dag_tasks ADD COLUMN max_retry_delay_seconds INTEGER DEFAULT 3600";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Wall time an attempt may run before its process group is killed, 0 = no limit
+    sql = "ALTER TABLE dag_tasks ADD COLUMN timeout_seconds INTEGER DEFAULT 0";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // When a task runs given how its dependencies ended, see TriggerRule
+    sql = "ALTER TABLE dag_tasks ADD COLUMN trigger_rule TEXT DEFAULT 'all_success'";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Files a task's result depends on, one per line, and the file it writes,
+    // see task_cache.h
+    sql = "ALTER TABLE dag_tasks ADD COLUMN inputs TEXT";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    sql = "ALTER TABLE dag_tasks ADD COLUMN output TEXT";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
+    // Attempt number of a task within its run, every attempt has its own row
+    sql = "ALTER TABLE task_executions ADD COLUMN attempt INTEGER DEFAULT 1";
+    sqlite3_exec(db, sql, 0, 0, &ErrMsg);
+    if (ErrMsg) {
+        sqlite3_free(ErrMsg);
+        ErrMsg = 0;
+    }
+
     log_message("DAG migration completed\n");
     return db;
 }
@@ -308,7 +459,8 @@ int delete_dag(sqlite3 *db, int id) {
 // DAG Management Functions Implementation
 
 int insert_dag_db(sqlite3 *db, DAG *dag) {
-    const char *sql = "INSERT INTO dags (name, cron_expression, description, status) VALUES (?, ?, ?, ?)";
+    const char *sql = "INSERT INTO dags (name, cron_expression, description, status, max_parallel_tasks, max_active_runs, overlap_policy) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?) RETURNING id";
     sqlite3_stmt *stmt;
     
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
@@ -321,36 +473,34 @@ int insert_dag_db(sqlite3 *db, DAG *dag) {
     sqlite3_bind_text(stmt, 2, dag->cron_expression, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, dag->description, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 4, dag_status_to_string(dag->status), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 5, dag->max_parallel_tasks);
+    sqlite3_bind_int(stmt, 6, dag->max_active_runs);
+    sqlite3_bind_text(stmt, 7, overlap_policy_to_string(dag->overlap_policy), -1, SQLITE_STATIC);
     
+    // RETURNING rather than sqlite3_last_insert_rowid, which other threads
+    // inserting through the same connection would race (runs, the web server)
     rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        dag->id = sqlite3_column_int(stmt, 0);
+    }
     sqlite3_finalize(stmt);
     
-    if (rc != SQLITE_DONE) {
+    if (rc != SQLITE_ROW) {
         log_message("Failed to insert DAG: %s\n", sqlite3_errmsg(db));
         return -1;
     }
-    
-    dag->id = sqlite3_last_insert_rowid(db);
+
     log_message("Successfully inserted DAG with id %d\n", dag->id);
     return dag->id;
 }
 
-int insert_dag_task_db(sqlite3 *db, DAGTask *task) {
-    const char *sql = "INSERT INTO dag_tasks (dag_id, task_name, task_execution, dependencies) VALUES (?, ?, ?, ?)";
-    sqlite3_stmt *stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        log_message("Failed to prepare DAG task insert statement: %s\n", sqlite3_errmsg(db));
-        return -1;
-    }
-    
-    // Convert dependencies to JSON string with safe buffer handling
-    char dependencies_json[JSON_DEPENDENCY_BUFFER_SIZE] = "[";
-    TaskDependency *dep = task->dependencies;
+// Writes dependencies as the JSON array stored in dag_tasks.dependencies;
+// buffer holds JSON_DEPENDENCY_BUFFER_SIZE bytes
+static void format_dependencies_json(TaskDependency *dep, char *buffer) {
     int first = 1;
     size_t json_len = 1; // Start with length of "["
-    
+
+    strcpy(buffer, "[");
     while (dep != NULL) {
         char dep_str[JSON_DEP_STRING_SIZE];
         int dep_str_len = snprintf(dep_str, sizeof(dep_str), "%s{\"task_id\":%d,\"task_name\":\"%s\"}", 
@@ -362,33 +512,98 @@ int insert_dag_task_db(sqlite3 *db, DAGTask *task) {
             break;
         }
         
-        strcat(dependencies_json, dep_str);
+        strcat(buffer, dep_str);
         json_len += dep_str_len;
         first = 0;
         dep = dep->next;
     }
-    strcat(dependencies_json, "]");
+    strcat(buffer, "]");
+}
+
+int insert_dag_task_db(sqlite3 *db, DAGTask *task) {
+    const char *sql = "INSERT INTO dag_tasks (dag_id, task_name, task_execution, dependencies, pool, retries, "
+                      "retry_delay_seconds, retry_backoff, max_retry_delay_seconds, timeout_seconds, trigger_rule, "
+                      "inputs, output) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) RETURNING id";
+    sqlite3_stmt *stmt;
+    
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare DAG task insert statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    char dependencies_json[JSON_DEPENDENCY_BUFFER_SIZE];
+    format_dependencies_json(task->dependencies, dependencies_json);
     
     sqlite3_bind_int(stmt, 1, task->dag_id);
     sqlite3_bind_text(stmt, 2, task->task_name, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, task->task_execution, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 4, dependencies_json, -1, SQLITE_TRANSIENT);
+    if (task->pool[0]) {
+        sqlite3_bind_text(stmt, 5, task->pool, -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(stmt, 5);
+    }
+    sqlite3_bind_int(stmt, 6, task->retries);
+    sqlite3_bind_int(stmt, 7, task->retry_delay_seconds);
+    sqlite3_bind_double(stmt, 8, task->retry_backoff);
+    sqlite3_bind_int(stmt, 9, task->max_retry_delay_seconds);
+    sqlite3_bind_int(stmt, 10, task->timeout_seconds);
+    sqlite3_bind_text(stmt, 11, trigger_rule_to_string(task->trigger_rule), -1, SQLITE_STATIC);
+    if (task->inputs) {
+        sqlite3_bind_text(stmt, 12, task->inputs, -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(stmt, 12);
+    }
+    if (task->output) {
+        sqlite3_bind_text(stmt, 13, task->output, -1, SQLITE_TRANSIENT);
+    } else {
+        sqlite3_bind_null(stmt, 13);
+    }
     
     rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        task->id = sqlite3_column_int(stmt, 0);
+    }
     sqlite3_finalize(stmt);
     
-    if (rc != SQLITE_DONE) {
+    if (rc != SQLITE_ROW) {
         log_message("Failed to insert DAG task: %s\n", sqlite3_errmsg(db));
         return -1;
     }
-    
-    task->id = sqlite3_last_insert_rowid(db);
+
     log_message("Successfully inserted DAG task with id %d\n", task->id);
     return task->id;
 }
 
+// Replaces the stored dependencies of a task that is already in dag_tasks
+int insert_task_dependencies_db(sqlite3 *db, int task_id, TaskDependency *dependencies) {
+    const char *sql = "UPDATE dag_tasks SET dependencies = ? WHERE id = ?";
+    sqlite3_stmt *stmt;
+    
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare DAG task dependencies statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    char dependencies_json[JSON_DEPENDENCY_BUFFER_SIZE];
+    format_dependencies_json(dependencies, dependencies_json);
+    sqlite3_bind_text(stmt, 1, dependencies_json, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, task_id);
+    
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        log_message("Failed to store dependencies of DAG task %d: %s\n", task_id, sqlite3_errmsg(db));
+        return -1;
+    }
+    return 0;
+}
+
 int insert_dag_execution_db(sqlite3 *db, DAGExecution *execution) {
-    const char *sql = "INSERT INTO dag_executions (dag_id, execution_id, status, started_at) VALUES (?, ?, ?, CURRENT_TIMESTAMP)";
+    const char *sql = "INSERT INTO dag_executions (dag_id, execution_id, status, started_at, dispatch_delay_ms) VALUES (?, ?, ?, CURRENT_TIMESTAMP, ?) RETURNING id";
     sqlite3_stmt *stmt;
     
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
@@ -400,22 +615,25 @@ int insert_dag_execution_db(sqlite3 *db, DAGExecution *execution) {
     sqlite3_bind_int(stmt, 1, execution->dag_id);
     sqlite3_bind_text(stmt, 2, execution->execution_id, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, execution_status_to_string(execution->status), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 4, execution->dispatch_delay_ms);
     
     rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        execution->id = sqlite3_column_int(stmt, 0);
+    }
     sqlite3_finalize(stmt);
     
-    if (rc != SQLITE_DONE) {
+    if (rc != SQLITE_ROW) {
         log_message("Failed to insert DAG execution: %s\n", sqlite3_errmsg(db));
         return -1;
     }
-    
-    execution->id = sqlite3_last_insert_rowid(db);
+
     log_message("Successfully inserted DAG execution with id %d\n", execution->id);
     return execution->id;
 }
 
 int insert_task_execution_db(sqlite3 *db, TaskExecution *execution) {
-    const char *sql = "INSERT INTO task_executions (dag_execution_id, task_id, task_name, status, started_at) VALUES (?, ?, ?, ?, CURRENT_TIMESTAMP)";
+    const char *sql = "INSERT INTO task_executions (dag_execution_id, task_id, task_name, status, attempt, started_at) VALUES (?, ?, ?, ?, ?, CURRENT_TIMESTAMP) RETURNING id";
     sqlite3_stmt *stmt;
     
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
@@ -428,16 +646,19 @@ int insert_task_execution_db(sqlite3 *db, TaskExecution *execution) {
     sqlite3_bind_int(stmt, 2, execution->task_id);
     sqlite3_bind_text(stmt, 3, execution->task_name, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 4, execution_status_to_string(execution->status), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 5, execution->attempt > 0 ? execution->attempt : 1);
     
     rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        execution->id = sqlite3_column_int(stmt, 0);
+    }
     sqlite3_finalize(stmt);
     
-    if (rc != SQLITE_DONE) {
+    if (rc != SQLITE_ROW) {
         log_message("Failed to insert task execution: %s\n", sqlite3_errmsg(db));
         return -1;
     }
-    
-    execution->id = sqlite3_last_insert_rowid(db);
+
     log_message("Successfully inserted task execution with id %d\n", execution->id);
     return execution->id;
 }
@@ -468,8 +689,9 @@ int update_dag_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatu
     return 1;
 }
 
-int update_task_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message) {
-    const char *sql = "UPDATE task_executions SET status = ?, completed_at = CURRENT_TIMESTAMP, error_message = ? WHERE id = ?";
+int update_task_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message,
+                                    long duration_ms) {
+    const char *sql = "UPDATE task_executions SET status = ?, completed_at = CURRENT_TIMESTAMP, error_message = ?, duration_ms = ? WHERE id = ?";
     sqlite3_stmt *stmt;
     
     int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
@@ -480,7 +702,12 @@ int update_task_execution_status_db(sqlite3 *db, int execution_id, ExecutionStat
     
     sqlite3_bind_text(stmt, 1, execution_status_to_string(status), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 2, error_message ? error_message : "", -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 3, execution_id);
+    if (duration_ms >= 0) {
+        sqlite3_bind_int64(stmt, 3, duration_ms);
+    } else {
+        sqlite3_bind_null(stmt, 3);
+    }
+    sqlite3_bind_int(stmt, 4, execution_id);
     
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
@@ -524,6 +751,96 @@ int delete_dag_by_id_db(sqlite3 *db, int dag_id) {
     return 1;
 }
 
+int save_pool_db(sqlite3 *db, const char *name, int slots) {
+    const char *sql = "INSERT INTO pools (name, slots) VALUES (?, ?) "
+                      "ON CONFLICT(name) DO UPDATE SET slots = excluded.slots";
+    sqlite3_stmt *stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare pool save statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, slots);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE) {
+        log_message("Failed to save pool %s: %s\n", name, sqlite3_errmsg(db));
+        return -1;
+    }
+    return 0;
+}
+
+int load_pools_db(sqlite3 *db) {
+    const char *sql = "SELECT name, slots FROM pools";
+    sqlite3_stmt *stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare pools load statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    int count = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char *name = (const char*)sqlite3_column_text(stmt, 0);
+        if (name && task_executor_set_pool(name, sqlite3_column_int(stmt, 1)) == 0) count++;
+    }
+    sqlite3_finalize(stmt);
+
+    log_message("Loaded %d resource pools\n", count);
+    return count;
+}
+
+int update_dag_db(sqlite3 *db, int dag_id, const char *name, const char *cron_expression, const char *description,
+                  int max_parallel_tasks, int max_active_runs, int overlap_policy) {
+    const char *sql = "UPDATE dags SET name = ?, cron_expression = ?, description = ?, "
+                      "max_parallel_tasks = CASE WHEN ?5 < 0 THEN max_parallel_tasks ELSE ?5 END, "
+                      "max_active_runs = CASE WHEN ?6 < 0 THEN max_active_runs ELSE ?6 END, "
+                      "overlap_policy = COALESCE(?7, overlap_policy), "
+                      "updated_at = CURRENT_TIMESTAMP WHERE id = ?4";
+    sqlite3_stmt *stmt;
+    
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare DAG update statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, cron_expression, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, description ? description : "", -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 4, dag_id);
+    sqlite3_bind_int(stmt, 5, max_parallel_tasks);
+    sqlite3_bind_int(stmt, 6, max_active_runs);
+    if (overlap_policy >= 0) {
+        sqlite3_bind_text(stmt, 7, overlap_policy_to_string(overlap_policy), -1, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, 7);
+    }
+    
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        log_message("Failed to update DAG: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    int changes = sqlite3_changes(db);
+    if (changes == 0) {
+        log_message("No DAG found with id %d\n", dag_id);
+        return 0;
+    }
+    
+    log_message("Successfully updated DAG with id %d\n", dag_id);
+    return 1;
+}
+
 // Enhanced transaction logging with DAG context
 int log_dag_task_status(sqlite3 *db, int task_id, int dag_id, int dag_execution_id, const char *status, const char *details) {
     const char *sql = "INSERT INTO transaction_status (task_id, status, details, dag_id, dag_execution_id) VALUES (?, ?, ?, ?, ?)";
@@ -578,8 +895,177 @@ TaskDependency* parse_dependencies_json(const char *json_str);
 
 // DAG Query Functions
 
+// Builds a DAG (with its tasks) from a "SELECT id, name, cron_expression, description, status, created_at, updated_at,
+// max_parallel_tasks, max_active_runs, overlap_policy" row
+static DAG* load_dag_from_row(sqlite3 *db, sqlite3_stmt *stmt) {
+    DAG *dag = malloc(sizeof(DAG));
+    if (!dag) return NULL;
+
+    memset(dag, 0, sizeof(DAG));
+    dag->id = sqlite3_column_int(stmt, 0);
+    strncpy(dag->name, (const char*)sqlite3_column_text(stmt, 1), MAX_DAG_NAME_LENGTH - 1);
+    if (dag_set_schedule(dag, (const char*)sqlite3_column_text(stmt, 2)) != 0) {
+        free(dag);
+        return NULL;
+    }
+    if (!dag->schedule->valid) {
+        log_message("Invalid cron expression '%s' for DAG %s, it will never run\n", dag->cron_expression, dag->name);
+    }
+    const char *description = (const char*)sqlite3_column_text(stmt, 3);
+    strncpy(dag->description, description ? description : "", MAX_DESCRIPTION_LENGTH - 1);
+    dag->status = string_to_dag_status((const char*)sqlite3_column_text(stmt, 4));
+    dag->created_at = sqlite3_column_int64(stmt, 5);
+    dag->updated_at = sqlite3_column_int64(stmt, 6);
+    dag->max_parallel_tasks = sqlite3_column_int(stmt, 7);
+    dag->max_active_runs = sqlite3_column_int(stmt, 8);
+    const char *overlap_policy = (const char*)sqlite3_column_text(stmt, 9);
+    int policy = overlap_policy ? string_to_overlap_policy(overlap_policy) : -1;
+    dag->overlap_policy = policy < 0 ? OVERLAP_POLICY_QUEUE : policy;
+
+    // Load tasks for this DAG
+    dag->tasks = load_dag_tasks_db(db, dag->id);
+    dag->task_count = count_dag_tasks(dag->tasks);
+    dag->plan = compile_dag(dag);
+
+    return dag;
+}
+
+// Oldest first, so each task's ring ends up holding its most recent runs
+int load_task_durations_db(sqlite3 *db, CompiledDAG *plan) {
+    if (!plan->valid) return 0;
+
+    const char *sql = "SELECT task_id, duration_ms FROM ("
+                      "SELECT te.id, te.task_id, te.duration_ms, "
+                      "ROW_NUMBER() OVER (PARTITION BY te.task_id ORDER BY te.id DESC) AS recent "
+                      "FROM task_executions te JOIN dag_tasks t ON t.id = te.task_id "
+                      "WHERE t.dag_id = ? AND te.status = 'success' AND te.duration_ms IS NOT NULL"
+                      ") WHERE recent <= ? ORDER BY id";
+    sqlite3_stmt *stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare task duration statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_int(stmt, 1, plan->dag_id);
+    sqlite3_bind_int(stmt, 2, DAG_DURATION_SAMPLES);
+
+    int loaded = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int index = compiled_dag_index(plan, sqlite3_column_int(stmt, 0));
+        if (index < 0) continue;
+        if (dag_plan_add_duration(plan, index, (long)sqlite3_column_int64(stmt, 1)) < 0) break;
+        loaded++;
+    }
+    sqlite3_finalize(stmt);
+
+    if (loaded > 0) {
+        dag_plan_compute_priorities(plan);
+    }
+    return loaded;
+}
+
+// Marks the tasks of plan that succeeded in the DAG's execution execution_id.
+// Returns how many did, -1 when the DAG has no such execution.
+int load_succeeded_tasks_db(sqlite3 *db, const CompiledDAG *plan, const char *execution_id, char *succeeded) {
+    const char *sql = "SELECT te.task_id FROM dag_executions de "
+                      "LEFT JOIN task_executions te ON te.dag_execution_id = de.id "
+                      "AND te.status IN ('success', 'cached') "
+                      "WHERE de.dag_id = ? AND de.execution_id = ?";
+    sqlite3_stmt *stmt;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare succeeded tasks statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_int(stmt, 1, plan->dag_id);
+    sqlite3_bind_text(stmt, 2, execution_id, -1, SQLITE_TRANSIENT);
+
+    // The execution's row comes back even when none of its tasks succeeded
+    int found = 0;
+    int loaded = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        found = 1;
+        if (sqlite3_column_type(stmt, 0) == SQLITE_NULL) continue;
+        int index = compiled_dag_index(plan, sqlite3_column_int(stmt, 0));
+        if (index < 0 || succeeded[index]) continue;
+        succeeded[index] = 1;
+        loaded++;
+    }
+    sqlite3_finalize(stmt);
+
+    return found ? loaded : -1;
+}
+
+static int compare_dags_by_id(const void *a, const void *b) {
+    int left = (*(DAG* const*)a)->id;
+    int right = (*(DAG* const*)b)->id;
+    return (left > right) - (left < right);
+}
+
+// load_task_durations_db for a whole catalog in one statement, a statement
+// per DAG costs more than the history itself when most DAGs have none
+static void load_all_task_durations_db(sqlite3 *db, DAG *dag_list) {
+    const char *sql = "SELECT dag_id, task_id, duration_ms FROM ("
+                      "SELECT te.id, t.dag_id, te.task_id, te.duration_ms, "
+                      "ROW_NUMBER() OVER (PARTITION BY te.task_id ORDER BY te.id DESC) AS recent "
+                      "FROM task_executions te JOIN dag_tasks t ON t.id = te.task_id "
+                      "WHERE te.status = 'success' AND te.duration_ms IS NOT NULL"
+                      ") WHERE recent <= ? ORDER BY dag_id, id";
+    sqlite3_stmt *stmt;
+
+    int count = 0;
+    for (DAG *dag = dag_list; dag; dag = dag->next) count++;
+    if (count == 0) return;
+
+    DAG **by_id = malloc(count * sizeof(DAG*));
+    if (!by_id) {
+        log_message("Failed to allocate DAG index for task durations\n");
+        return;
+    }
+    int index = 0;
+    for (DAG *dag = dag_list; dag; dag = dag->next) by_id[index++] = dag;
+    qsort(by_id, count, sizeof(DAG*), compare_dags_by_id);
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare task duration statement: %s\n", sqlite3_errmsg(db));
+        free(by_id);
+        return;
+    }
+    sqlite3_bind_int(stmt, 1, DAG_DURATION_SAMPLES);
+
+    // Rows come grouped by DAG, each plan is recomputed once its rows end
+    CompiledDAG *plan = NULL;
+    int plan_dag_id = -1;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int dag_id = sqlite3_column_int(stmt, 0);
+        if (dag_id != plan_dag_id) {
+            dag_plan_compute_priorities(plan);
+            plan_dag_id = dag_id;
+
+            DAG key = { .id = dag_id };
+            DAG *key_pointer = &key;
+            DAG **found = bsearch(&key_pointer, by_id, count, sizeof(DAG*), compare_dags_by_id);
+            plan = found && (*found)->plan && (*found)->plan->valid ? (*found)->plan : NULL;
+        }
+        if (!plan) continue;
+
+        int task = compiled_dag_index(plan, sqlite3_column_int(stmt, 1));
+        if (task >= 0) dag_plan_add_duration(plan, task, (long)sqlite3_column_int64(stmt, 2));
+    }
+    dag_plan_compute_priorities(plan);
+
+    sqlite3_finalize(stmt);
+    free(by_id);
+}
+
 DAG* load_all_dags_db(sqlite3 *db) {
-    const char *sql = "SELECT id, name, cron_expression, description, status, created_at, updated_at FROM dags WHERE status = 'active'";
+    const char *sql = "SELECT id, name, cron_expression, description, status, created_at, updated_at, max_parallel_tasks, "
+                      "max_active_runs, overlap_policy FROM dags WHERE status = 'active'";
     sqlite3_stmt *stmt;
     DAG *dag_list = NULL;
 
@@ -590,32 +1076,47 @@ DAG* load_all_dags_db(sqlite3 *db) {
     }
 
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        DAG *dag = malloc(sizeof(DAG));
+        DAG *dag = load_dag_from_row(db, stmt);
         if (!dag) continue;
 
-        memset(dag, 0, sizeof(DAG));
-        dag->id = sqlite3_column_int(stmt, 0);
-        strncpy(dag->name, (const char*)sqlite3_column_text(stmt, 1), MAX_DAG_NAME_LENGTH - 1);
-        strncpy(dag->cron_expression, (const char*)sqlite3_column_text(stmt, 2), MAX_CRON_EXPRESSION_LENGTH - 1);
-        strncpy(dag->description, (const char*)sqlite3_column_text(stmt, 3), MAX_DESCRIPTION_LENGTH - 1);
-        dag->status = string_to_dag_status((const char*)sqlite3_column_text(stmt, 4));
-        dag->created_at = sqlite3_column_int64(stmt, 5);
-        dag->updated_at = sqlite3_column_int64(stmt, 6);
-
-        // Load tasks for this DAG
-        dag->tasks = load_dag_tasks_db(db, dag->id);
-        dag->task_count = count_dag_tasks(dag->tasks);
-
         dag->next = dag_list;
         dag_list = dag;
     }
 
     sqlite3_finalize(stmt);
+    load_all_task_durations_db(db, dag_list);
     return dag_list;
 }
 
+DAG* load_dag_by_id_db(sqlite3 *db, int dag_id) {
+    const char *sql = "SELECT id, name, cron_expression, description, status, created_at, updated_at, max_parallel_tasks, "
+                      "max_active_runs, overlap_policy FROM dags WHERE id = ?";
+    sqlite3_stmt *stmt;
+    DAG *dag = NULL;
+
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_message("Failed to prepare DAG load statement: %s\n", sqlite3_errmsg(db));
+        return NULL;
+    }
+
+    sqlite3_bind_int(stmt, 1, dag_id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        dag = load_dag_from_row(db, stmt);
+    }
+
+    sqlite3_finalize(stmt);
+    if (dag && dag->plan) {
+        load_task_durations_db(db, dag->plan);
+    }
+    return dag;
+}
+
 DAGTask* load_dag_tasks_db(sqlite3 *db, int dag_id) {
-    const char *sql = "SELECT id, task_name, task_execution, dependencies FROM dag_tasks WHERE dag_id = ?";
+    const char *sql = "SELECT id, task_name, task_execution, dependencies, pool, retries, retry_delay_seconds, "
+                      "retry_backoff, max_retry_delay_seconds, timeout_seconds, trigger_rule, inputs, output "
+                      "FROM dag_tasks "
+                      "WHERE dag_id = ?";
     sqlite3_stmt *stmt;
     DAGTask *task_list = NULL;
 
@@ -641,6 +1142,21 @@ DAGTask* load_dag_tasks_db(sqlite3 *db, int dag_id) {
         const char *deps_json = (const char*)sqlite3_column_text(stmt, 3);
         task->dependencies = parse_dependencies_json(deps_json);
         task->dependency_count = count_dependencies(task->dependencies);
+        const char *pool = (const char*)sqlite3_column_text(stmt, 4);
+        if (pool) strncpy(task->pool, pool, MAX_POOL_NAME_LENGTH - 1);
+        task->retries = sqlite3_column_int(stmt, 5);
+        task->retry_delay_seconds = sqlite3_column_int(stmt, 6);
+        task->retry_backoff = sqlite3_column_double(stmt, 7);
+        task->max_retry_delay_seconds = sqlite3_column_int(stmt, 8);
+        task->timeout_seconds = sqlite3_column_int(stmt, 9);
+        const char *trigger_rule = (const char*)sqlite3_column_text(stmt, 10);
+        int rule = trigger_rule ? string_to_trigger_rule(trigger_rule) : -1;
+        task->trigger_rule = rule >= 0 ? rule : TRIGGER_RULE_ALL_SUCCESS;
+        if (set_dag_task_cache(task, (const char*)sqlite3_column_text(stmt, 11),
+                               (const char*)sqlite3_column_text(stmt, 12)) != 0) {
+            free_dag_task(task);
+            continue;
+        }
 
         task->next = task_list;
         task_list = task;
@@ -670,16 +1186,44 @@ int count_dependencies(TaskDependency *dep_list) {
     return count;
 }
 
+// Reads the array written by format_dependencies_json, keeping its order
 TaskDependency* parse_dependencies_json(const char *json_str) {
     if (!json_str) return NULL;
     
-    // Simple JSON parsing for dependencies - in production use proper JSON parser
-    // For now, return NULL (no dependencies)
-    return NULL;
+    cJSON *json = cJSON_Parse(json_str);
+    if (!cJSON_IsArray(json)) {
+        cJSON_Delete(json);
+        return NULL;
+    }
+    
+    TaskDependency *head = NULL;
+    TaskDependency **tail = &head;
+    cJSON *item;
+    cJSON_ArrayForEach(item, json) {
+        cJSON *task_id = cJSON_GetObjectItem(item, "task_id");
+        cJSON *task_name = cJSON_GetObjectItem(item, "task_name");
+        if (!cJSON_IsNumber(task_id)) continue;
+        
+        TaskDependency *dep = calloc(1, sizeof(TaskDependency));
+        if (!dep) {
+            log_message("Failed to allocate memory for task dependency\n");
+            break;
+        }
+        dep->task_id = task_id->valueint;
+        if (cJSON_IsString(task_name)) {
+            strncpy(dep->task_name, task_name->valuestring, MAX_TASK_NAME_LENGTH - 1);
+        }
+        *tail = dep;
+        tail = &dep->next;
+    }
+    
+    cJSON_Delete(json);
+    return head;
 }
 
 char* get_dags_json(sqlite3 *db) {
-    const char *sql = "SELECT id, name, cron_expression, description, status FROM dags";
+    const char *sql = "SELECT id, name, cron_expression, description, status, max_parallel_tasks, max_active_runs, "
+                      "overlap_policy FROM dags";
     sqlite3_stmt *stmt;
     
     size_t buffer_size = JSON_BUFFER_INITIAL_SIZE;
@@ -702,14 +1246,25 @@ char* get_dags_json(sqlite3 *db) {
         const char *cron = (const char*)sqlite3_column_text(stmt, 2);
         const char *desc = (const char*)sqlite3_column_text(stmt, 3);
         const char *status = (const char*)sqlite3_column_text(stmt, 4);
+        int max_parallel_tasks = sqlite3_column_int(stmt, 5);
+        int max_active_runs = sqlite3_column_int(stmt, 6);
+        const char *overlap_policy = (const char*)sqlite3_column_text(stmt, 7);
 
         if (!name) name = "";
         if (!cron) cron = "";
         if (!desc) desc = "";
         if (!status) status = "";
+        if (!overlap_policy) overlap_policy = "queue";
+
+        // What the scheduler actually runs, with H tokens resolved for this DAG
+        char resolved[256];
+        if (cron_resolve_hashed(cron, name, resolved, sizeof(resolved)) != 0) {
+            snprintf(resolved, sizeof(resolved), "%s", cron);
+        }
 
-        int needed = snprintf(NULL, 0, "%s{\"id\":%d,\"name\":\"%s\",\"cron_expression\":\"%s\",\"description\":\"%s\",\"status\":\"%s\"}",
-                             first_row ? "" : ",", id, name, cron, desc, status);
+        int needed = snprintf(NULL, 0, "%s{\"id\":%d,\"name\":\"%s\",\"cron_expression\":\"%s\",\"resolved_cron_expression\":\"%s\",\"description\":\"%s\",\"status\":\"%s\",\"max_parallel_tasks\":%d,\"max_active_runs\":%d,\"overlap_policy\":\"%s\"}",
+                             first_row ? "" : ",", id, name, cron, resolved, desc, status, max_parallel_tasks,
+                             max_active_runs, overlap_policy);
 
         if (pos + needed + 10 >= buffer_size) {
             if (!ensure_buffer_capacity(&json_result, &buffer_size, pos + needed + 10)) {
@@ -720,8 +1275,9 @@ char* get_dags_json(sqlite3 *db) {
         }
 
         pos += snprintf(json_result + pos, buffer_size - pos,
-                      "%s{\"id\":%d,\"name\":\"%s\",\"cron_expression\":\"%s\",\"description\":\"%s\",\"status\":\"%s\"}",
-                      first_row ? "" : ",", id, name, cron, desc, status);
+                      "%s{\"id\":%d,\"name\":\"%s\",\"cron_expression\":\"%s\",\"resolved_cron_expression\":\"%s\",\"description\":\"%s\",\"status\":\"%s\",\"max_parallel_tasks\":%d,\"max_active_runs\":%d,\"overlap_policy\":\"%s\"}",
+                      first_row ? "" : ",", id, name, cron, resolved, desc, status, max_parallel_tasks,
+                      max_active_runs, overlap_policy);
         first_row = 0;
     }
 
@@ -730,8 +1286,8 @@ char* get_dags_json(sqlite3 *db) {
     return json_result;
 }
 
-char* get_dag_status_json(sqlite3 *db, int dag_id) {
-    const char *sql = "SELECT d.id, d.name, d.status, de.execution_id, de.status, de.started_at, de.completed_at "
+char* get_dag_status_json(sqlite3 *db, int dag_id, const char *runs_json) {
+    const char *sql = "SELECT d.id, d.name, d.status, de.execution_id, de.status, de.started_at, de.completed_at, de.dispatch_delay_ms "
                      "FROM dags d LEFT JOIN dag_executions de ON d.id = de.dag_id "
                      "WHERE d.id = ? ORDER BY de.started_at DESC LIMIT 10";
     sqlite3_stmt *stmt;
@@ -757,12 +1313,13 @@ char* get_dag_status_json(sqlite3 *db, int dag_id) {
         const char *status = (const char*)sqlite3_column_text(stmt, 4);
         const char *started = (const char*)sqlite3_column_text(stmt, 5);
         const char *completed = (const char*)sqlite3_column_text(stmt, 6);
+        long long dispatch_delay_ms = sqlite3_column_int64(stmt, 7);
 
         if (!exec_id) continue;
 
-        int needed = snprintf(NULL, 0, "%s{\"execution_id\":\"%s\",\"status\":\"%s\",\"started_at\":\"%s\",\"completed_at\":\"%s\"}",
+        int needed = snprintf(NULL, 0, "%s{\"execution_id\":\"%s\",\"status\":\"%s\",\"started_at\":\"%s\",\"completed_at\":\"%s\",\"dispatch_delay_ms\":%lld}",
                              first_row ? "" : ",", exec_id ? exec_id : "", status ? status : "", 
-                             started ? started : "", completed ? completed : "");
+                             started ? started : "", completed ? completed : "", dispatch_delay_ms);
 
         if (pos + needed + 10 >= buffer_size) {
             if (!ensure_buffer_capacity(&json_result, &buffer_size, pos + needed + 10)) {
@@ -774,13 +1331,23 @@ char* get_dag_status_json(sqlite3 *db, int dag_id) {
 
         if (!first_row) pos += snprintf(json_result + pos, buffer_size - pos, ",");
         pos += snprintf(json_result + pos, buffer_size - pos,
-                      "{\"execution_id\":\"%s\",\"status\":\"%s\",\"started_at\":\"%s\",\"completed_at\":\"%s\"}",
+                      "{\"execution_id\":\"%s\",\"status\":\"%s\",\"started_at\":\"%s\",\"completed_at\":\"%s\",\"dispatch_delay_ms\":%lld}",
                       exec_id ? exec_id : "", status ? status : "", 
-                      started ? started : "", completed ? completed : "");
+                      started ? started : "", completed ? completed : "", dispatch_delay_ms);
         first_row = 0;
     }
 
-    pos += snprintf(json_result + pos, buffer_size - pos, "]}");
+    if (runs_json) {
+        size_t needed = strlen(runs_json) + 16;
+        if (pos + needed >= buffer_size && !ensure_buffer_capacity(&json_result, &buffer_size, pos + needed)) {
+            sqlite3_finalize(stmt);
+            free(json_result);
+            return NULL;
+        }
+        pos += snprintf(json_result + pos, buffer_size - pos, "],\"runs\":%s}", runs_json);
+    } else {
+        pos += snprintf(json_result + pos, buffer_size - pos, "]}");
+    }
     sqlite3_finalize(stmt);
     return json_result;
 }
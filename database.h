@@ -25,7 +25,12 @@ int insert_dag_task_db(sqlite3 *db, DAGTask *task);
 int insert_dag_execution_db(sqlite3 *db, DAGExecution *execution);
 int insert_task_execution_db(sqlite3 *db, TaskExecution *execution);
 int update_dag_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message);
-int update_task_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message);
+int update_task_execution_status_db(sqlite3 *db, int execution_id, ExecutionStatus status, const char *error_message,
+                                    long duration_ms);
+int load_task_durations_db(sqlite3 *db, CompiledDAG *plan);
+// Sets succeeded[i] for the tasks of plan that succeeded in the DAG's
+// execution execution_id. Returns how many, -1 when there is no such execution.
+int load_succeeded_tasks_db(sqlite3 *db, const CompiledDAG *plan, const char *execution_id, char *succeeded);
 
 // DAG Query Functions  
 DAG* load_dag_by_id_db(sqlite3 *db, int dag_id);
@@ -34,7 +39,8 @@ DAGTask* load_dag_tasks_db(sqlite3 *db, int dag_id);
 DAGExecution* load_dag_executions_db(sqlite3 *db, int dag_id);
 TaskExecution* load_task_executions_db(sqlite3 *db, int dag_execution_id);
 char* get_dags_json(sqlite3 *db);
-char* get_dag_status_json(sqlite3 *db, int dag_id);
+// runs_json, when given, is added as "runs": the run slots and queue of the DAG
+char* get_dag_status_json(sqlite3 *db, int dag_id, const char *runs_json);
 
 // DAG Utility Functions
 int count_dag_tasks(DAGTask *task_list);
@@ -43,7 +49,14 @@ TaskDependency* parse_dependencies_json(const char *json_str);
 
 // DAG Modification Functions
 int delete_dag_by_id_db(sqlite3 *db, int dag_id);
-int update_dag_db(sqlite3 *db, int dag_id, const char *name, const char *cron_expression, const char *description);
+int update_dag_db(sqlite3 *db, int dag_id, const char *name, const char *cron_expression, const char *description,
+                  int max_parallel_tasks, int max_active_runs, int overlap_policy);
+
+// Resource pool Functions
+// Creates the pool or changes its slots
+int save_pool_db(sqlite3 *db, const char *name, int slots);
+// Hands every stored pool to the task executor
+int load_pools_db(sqlite3 *db);
 
 // DAG Task Dependency Functions
 int insert_task_dependencies_db(sqlite3 *db, int task_id, TaskDependency *dependencies);
@@ -6,3 +6,14 @@ unsigned long hashString(const char *str) {
     }
     return hash;
 }
+
+// Finalizer from splitmix64: spreads nearby inputs (similar names, small
+// field indexes) across all bits so taking a modulo stays uniform
+unsigned long hashMix(unsigned long value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9UL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebUL;
+    value ^= value >> 31;
+    return value;
+}
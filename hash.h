@@ -1 +1,7 @@
-unsigned int hashString(const char* str);
+#ifndef CONDUIT_HASH_H
+#define CONDUIT_HASH_H
+
+unsigned long hashString(const char* str);
+unsigned long hashMix(unsigned long value);
+
+#endif
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <pthread.h>
 #include "thread.h"
@@ -7,6 +9,9 @@
 #include "logger.h"
 #include "transactions.h"
 #include "dag_scheduler.h"
+#include "clock_source.h"
+#include "task_executor.h"
+#include "task_cache.h"
 
 void initialize_test_tasks(void) {
 
@@ -22,6 +27,7 @@ void initialize_test_tasks(void) {
 // Start DAG scheduler in separate thread
 void start_dag_scheduler_thread(sqlite3 *db) {
     pthread_t dag_scheduler_thread;
+    clock_source_attach();
     int result = pthread_create(&dag_scheduler_thread, NULL, (void*)dag_scheduler, db);
     if (result != 0) {
         log_message("Failed to create DAG scheduler thread\n");
@@ -39,9 +45,44 @@ int main(int argc, char *argv[]){
         return 1;
     }
 
+    // Simulated clock for replaying schedules faster than real time
+    ClockSourceMode clock_mode = CLOCK_SOURCE_REAL;
+    time_t clock_start = 0;
+    double clock_speed = 1;
+    time_t clock_until = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--max-dag-starts=", 17) == 0) {
+            set_dag_start_rate(atof(argv[i] + 17));
+        } else if (strncmp(argv[i], "--executor-workers=", 19) == 0) {
+            task_executor_set_workers(atoi(argv[i] + 19));
+        } else if (strncmp(argv[i], "--max-task-processes=", 21) == 0) {
+            task_executor_set_max_processes(atoi(argv[i] + 21));
+        } else if (strncmp(argv[i], "--task-cache-dir=", 17) == 0) {
+            task_cache_set_dir(argv[i] + 17);
+        } else if (strncmp(argv[i], "--sim-start=", 12) == 0) {
+            clock_start = (time_t)atoll(argv[i] + 12);
+            if (clock_mode == CLOCK_SOURCE_REAL) clock_mode = CLOCK_SOURCE_ACCELERATED;
+        } else if (strncmp(argv[i], "--sim-speed=", 12) == 0) {
+            clock_speed = atof(argv[i] + 12);
+            clock_mode = CLOCK_SOURCE_ACCELERATED;
+        } else if (strncmp(argv[i], "--sim-until=", 12) == 0) {
+            clock_until = (time_t)atoll(argv[i] + 12);
+        } else if (strcmp(argv[i], "--sim-virtual") == 0) {
+            clock_mode = CLOCK_SOURCE_VIRTUAL;
+        }
+    }
+    if (clock_source_configure(clock_mode, clock_start, clock_speed, clock_until) != 0) {
+        fprintf(stderr, "Invalid clock settings. Exiting.\n");
+        return 1;
+    }
+    // The main loop below sleeps on the clock as well
+    clock_source_attach();
+
     db = initialize_database();
     dag_migration(db);
     transactions_status_migration(db);
+    load_pools_db(db);
 
     initialize_test_tasks(); // Remove today if possible (13-05)
     
@@ -63,7 +104,7 @@ int main(int argc, char *argv[]){
         dag_import(db, taskListHead);
         
         log_message("Main program is running - both legacy tasks and DAGs active\n");
-        sleep(60); // Increased to 60 seconds to reduce log noise
+        clock_sleep_ms(60000); // Increased to 60 seconds to reduce log noise
     }
 
     shutdown_database(db);
@@ -11,7 +11,10 @@
 #define RESPONSE_DAG_SUCCESS_CREATED "{\"success\":true,\"message\":\"DAG created successfully\",\"dag_id\":%d}"
 #define RESPONSE_DAG_SUCCESS_UPDATED "{\"success\":true,\"message\":\"DAG updated successfully\"}"
 #define RESPONSE_DAG_SUCCESS_DELETED "{\"success\":true,\"message\":\"DAG deleted successfully\"}"
-#define RESPONSE_DAG_SUCCESS_TRIGGERED "{\"success\":true,\"message\":\"DAG execution triggered successfully\"}"
+#define RESPONSE_DAG_SUCCESS_TRIGGERED "{\"success\":true,\"message\":\"DAG execution triggered successfully\",\"execution_id\":\"%s\"}"
+#define RESPONSE_RUN_SUCCESS_CANCELLED "{\"success\":true,\"message\":\"Run cancellation requested\"}"
+#define RESPONSE_RUN_SUCCESS_RESUMED "{\"success\":true,\"message\":\"Run resumed successfully\",\"execution_id\":\"%s\"}"
+#define RESPONSE_POOL_SUCCESS_SAVED "{\"success\":true,\"message\":\"Pool saved successfully\"}"
 
 // Error responses
 #define RESPONSE_ERROR_METHOD_NOT_ALLOWED "{\"error\":true,\"message\":\"Only POST method is allowed\"}"
@@ -29,6 +32,9 @@
 
 // DAG Error responses
 #define RESPONSE_ERROR_DAG_NOT_FOUND "{\"error\":true,\"message\":\"DAG not found\"}"
+#define RESPONSE_ERROR_RUN_NOT_ACTIVE "{\"error\":true,\"message\":\"No active run with that execution id\"}"
+#define RESPONSE_ERROR_RUN_NOT_FINISHED "{\"error\":true,\"message\":\"No finished run with that execution id\"}"
+#define RESPONSE_ERROR_RUN_RESUME_FAILED "{\"error\":true,\"message\":\"Failed to resume run\"}"
 #define RESPONSE_ERROR_DAG_CREATE_FAILED "{\"error\":true,\"message\":\"Failed to create DAG\"}"
 #define RESPONSE_ERROR_DAG_UPDATE_FAILED "{\"error\":true,\"message\":\"Failed to update DAG\"}"
 #define RESPONSE_ERROR_DAG_DELETE_FAILED "{\"error\":true,\"message\":\"Failed to delete DAG\"}"
@@ -37,6 +43,18 @@
 #define RESPONSE_ERROR_DAG_CYCLE_DETECTED "{\"error\":true,\"message\":\"Circular dependency detected in DAG\"}"
 #define RESPONSE_ERROR_MISSING_DAG_NAME "{\"error\":true,\"message\":\"Missing required field: name\"}"
 #define RESPONSE_ERROR_MISSING_CRON_EXPRESSION "{\"error\":true,\"message\":\"Missing required field: cron_expression\"}"
+#define RESPONSE_ERROR_INVALID_CRON_EXPRESSION "{\"error\":true,\"message\":\"Invalid cron expression\"}"
+#define RESPONSE_ERROR_INVALID_FORECAST_HOURS "{\"error\":true,\"message\":\"hours must be between 1 and 168\"}"
+#define RESPONSE_ERROR_INVALID_MAX_PARALLEL_TASKS "{\"error\":true,\"message\":\"max_parallel_tasks must be a non-negative integer\"}"
+#define RESPONSE_ERROR_INVALID_MAX_ACTIVE_RUNS "{\"error\":true,\"message\":\"max_active_runs must be a non-negative integer\"}"
+#define RESPONSE_ERROR_INVALID_OVERLAP_POLICY "{\"error\":true,\"message\":\"overlap_policy must be one of queue, skip or cancel_previous\"}"
+#define RESPONSE_ERROR_INVALID_POOL_NAME "{\"error\":true,\"message\":\"pool must be 1-63 letters, digits, '_', '-' or '.'\"}"
+#define RESPONSE_ERROR_INVALID_TASK_RETRIES "{\"error\":true,\"message\":\"retries must be 0-100, retry_delay_seconds and max_retry_delay_seconds non-negative integers, retry_backoff at least 1\"}"
+#define RESPONSE_ERROR_INVALID_TASK_TIMEOUT "{\"error\":true,\"message\":\"timeout_seconds must be a non-negative integer\"}"
+#define RESPONSE_ERROR_INVALID_TASK_CACHE "{\"error\":true,\"message\":\"inputs must be a list of file paths and output a file path of a task with inputs\"}"
+#define RESPONSE_ERROR_INVALID_TRIGGER_RULE "{\"error\":true,\"message\":\"trigger_rule must be one of all_success, all_done, one_failed or none_failed\"}"
+#define RESPONSE_ERROR_INVALID_POOL_SLOTS "{\"error\":true,\"message\":\"slots must be a positive integer\"}"
+#define RESPONSE_ERROR_POOL_SAVE_FAILED "{\"error\":true,\"message\":\"Failed to save pool\"}"
 #define RESPONSE_ERROR_MISSING_TASKS "{\"error\":true,\"message\":\"Missing required field: tasks\"}"
 
 // Empty responses
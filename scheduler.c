@@ -3,42 +3,25 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "scheduler.h"
 #include "cron.h"
 #include "thread.h"
 #include "logger.h"
 #include "transactions.h"
 #include "hash.h"
+#include "wakeup.h"
+#include "clock_source.h"
 
 Task *taskListHead = NULL;
-
-int is_time_to_run(const char *cronExpression, struct CronTime now) {
-    char *fields[5];
-    char *copy = strdup(cronExpression);
-    char *token = strtok(copy, " ");
-
-    for (int i = 0; i < 5; i++) {
-        if (!token) {
-            free(copy);
-            return 0;
-        }
-        fields[i] = token;
-        token = strtok(NULL, " ");
-    }
-
-    int result = 1;
-    result &= match_cron_field(fields[0], now.minute, 0, 59);
-    result &= match_cron_field(fields[1], now.hour, 0, 23);
-    result &= match_cron_field(fields[2], now.day_of_month, 1, 31);
-    result &= match_cron_field(fields[3], now.month, 1, 12);
-    result &= match_cron_field(fields[4], now.day_of_week, 0, 6);
-
-    free(copy);
-    return result;
-}
+static pthread_mutex_t task_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SchedulerWakeup task_list_changed = SCHEDULER_WAKEUP_INITIALIZER;
+static TimerHeap task_timers = { NULL, 0, 0 };
+// Last second already dispatched, every schedule is evaluated strictly after it
+static time_t task_cursor = 0;
 
 void execute_task(Task task) {
-    spawn_worker_thread(&task);
+    spawn_worker_task(&task);
     log_message("Task triggered: %s\n", task.taskName);
 }
 
@@ -53,14 +36,29 @@ Task* add_task(const char *name, const char *cronExpression, const char *executi
     strlcpy(new_task->taskName, name, sizeof(new_task->taskName));
     strlcpy(new_task->taskExecution, execution, sizeof(new_task->taskExecution));
     strlcpy(new_task->cronExpression, cronExpression, sizeof(new_task->cronExpression));
+    if (cron_compile_seeded(new_task->cronExpression, new_task->taskName, &new_task->schedule) != 0) {
+        log_message("Invalid cron expression '%s' for task %s, it will never run\n", cronExpression, name);
+    }
+
+    timer_node_init(&new_task->timer, new_task);
 
+    pthread_mutex_lock(&task_list_mutex);
     new_task->next = taskListHead;
     taskListHead = new_task;
 
+    if (task_cursor == 0) task_cursor = clock_now();
+    time_t next_run = cron_next_fire(&new_task->schedule, task_cursor);
+    if (next_run != -1) timer_heap_push(&task_timers, &new_task->timer, next_run);
+    wakeup_notify(&task_list_changed);
+    pthread_mutex_unlock(&task_list_mutex);
+
     return new_task;
 }
 
 void free_tasks() {
+    pthread_mutex_lock(&task_list_mutex);
+    // The heap points into the tasks, empty it before they go
+    timer_heap_clear(&task_timers);
     Task *current = taskListHead;
     while (current != NULL) {
         Task *next = current->next;
@@ -68,33 +66,39 @@ void free_tasks() {
         current = next;
     }
     taskListHead = NULL;
+    wakeup_notify(&task_list_changed);
+    pthread_mutex_unlock(&task_list_mutex);
     log_message("Tasks freed successfully\n");
 }
 
 void scheduler(sqlite3 *db) {
+    pthread_mutex_lock(&task_list_mutex);
+    if (task_cursor == 0) task_cursor = clock_now();
+
     while(1) {
-        time_t now = time(NULL);
-        struct tm *current_time = localtime(&now);
+        // Sleep until the earliest due task, add_task/free_tasks wake us up early
+        TimerNode *next = timer_heap_peek(&task_timers);
+        struct timespec deadline = { .tv_sec = next ? next->due : 0, .tv_nsec = 0 };
+        if (!wakeup_wait(&task_list_changed, &task_list_mutex, next ? &deadline : NULL)) continue;
+
+        // Only the tasks due now are touched, the rest of the heap is left alone
+        time_t now = clock_now();
+        while ((next = timer_heap_peek(&task_timers)) != NULL && next->due <= now) {
+            Task *current = next->owner;
+            time_t due = next->due;
+            timer_heap_pop(&task_timers);
 
-        struct CronTime cronTime = {
-                    current_time->tm_min,
-                    current_time->tm_hour,
-                    current_time->tm_mday,
-                    current_time->tm_mon + 1,  // tm_mon is 0-11, CronTime expects 1-12
-                    current_time->tm_wday  // 0-6, Sunday = 0
-                };
+            int task_id = hashString(current->taskName);
+            log_task_status(db, task_id, "STARTED", current->taskExecution);
+            // Not sure yet if i have to add some unique id for tasks, technically one task can only be running exclusively but thinking about edge cases, im sleepy gonna think tomorrow
+            execute_task(*current);
+            log_task_status(db, task_id, "FINISHED", current->taskExecution);
 
-        Task *current = taskListHead; // *current is the current task what will iterate all the other ones through the linked list
-        while (current != NULL) {
-            if (is_time_to_run(current->cronExpression, cronTime)) {
-                int task_id = hashString(current->taskName);
-                log_task_status(db, task_id, "STARTED", current->taskExecution);
-                // Not sure yet if i have to add some unique id for tasks, technically one task can only be running exclusively but thinking about edge cases, im sleepy gonna think tomorrow
-                execute_task(*current);
-                log_task_status(db, task_id, "FINISHED", current->taskExecution);
-            }
-            current = current->next;
+            // If we woke up late, don't replay every missed second
+            time_t next_run = cron_next_fire(&current->schedule, (now - 1 > due) ? now - 1 : due);
+            if (next_run != -1) timer_heap_push(&task_timers, &current->timer, next_run);
+            if (due > task_cursor) task_cursor = due;
         }
-        sleep(30);
+        if (now - 1 > task_cursor) task_cursor = now - 1;
     }
 }
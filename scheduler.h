@@ -2,10 +2,14 @@
 #define CONDUIT_SCHEDULER_H
 
 #include <sqlite3.h>
+#include "cron.h"
+#include "stack.h"
 
 typedef struct Task{
     char taskName[64];
     char cronExpression[256];
+    CronSchedule schedule;
+    TimerNode timer;
     char taskExecution[64];
     struct Task *next;
 } Task;
@@ -1,5 +1,135 @@
-// Have to think yet but
-// Thinking about a heap implementation so the size don't make a real difference
-// but still not sure if its the best way here
-// Also using this project to think which is kinda obvious at this point
-// Heap -> Store a list of dag struct that will get these char taskName[64]; int hour; int minute; char task_execution[64];
\ No newline at end of file
+// Heap of scheduled items: the schedulers only look at the root to know when
+// to wake up, so per tick work depends on how many items are due and not on
+// the size of the catalog. Push, pop and re-keying are O(log n).
+#include <stdlib.h>
+#include "stack.h"
+
+#define TIMER_HEAP_ARITY 4
+#define TIMER_HEAP_INITIAL_CAPACITY 64
+
+void timer_node_init(TimerNode *node, void *owner) {
+    node->due = 0;
+    node->heap_index = -1;
+    node->owner = owner;
+}
+
+void timer_heap_init(TimerHeap *heap) {
+    heap->nodes = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+}
+
+void timer_heap_free(TimerHeap *heap) {
+    timer_heap_clear(heap);
+    free(heap->nodes);
+    timer_heap_init(heap);
+}
+
+void timer_heap_clear(TimerHeap *heap) {
+    for (int i = 0; i < heap->size; i++) {
+        heap->nodes[i]->heap_index = -1;
+    }
+    heap->size = 0;
+}
+
+static void timer_heap_place(TimerHeap *heap, TimerNode *node, int index) {
+    heap->nodes[index] = node;
+    node->heap_index = index;
+}
+
+static void timer_heap_sift_up(TimerHeap *heap, int index) {
+    TimerNode *node = heap->nodes[index];
+
+    while (index > 0) {
+        int parent = (index - 1) / TIMER_HEAP_ARITY;
+        if (heap->nodes[parent]->due <= node->due) break;
+        timer_heap_place(heap, heap->nodes[parent], index);
+        index = parent;
+    }
+    timer_heap_place(heap, node, index);
+}
+
+static void timer_heap_sift_down(TimerHeap *heap, int index) {
+    TimerNode *node = heap->nodes[index];
+
+    while (1) {
+        int first_child = index * TIMER_HEAP_ARITY + 1;
+        if (first_child >= heap->size) break;
+
+        int last_child = first_child + TIMER_HEAP_ARITY;
+        if (last_child > heap->size) last_child = heap->size;
+
+        int smallest = first_child;
+        for (int child = first_child + 1; child < last_child; child++) {
+            if (heap->nodes[child]->due < heap->nodes[smallest]->due) smallest = child;
+        }
+
+        if (heap->nodes[smallest]->due >= node->due) break;
+        timer_heap_place(heap, heap->nodes[smallest], index);
+        index = smallest;
+    }
+    timer_heap_place(heap, node, index);
+}
+
+int timer_heap_push(TimerHeap *heap, TimerNode *node, time_t due) {
+    if (node->heap_index >= 0) {
+        return timer_heap_update(heap, node, due);
+    }
+
+    if (heap->size == heap->capacity) {
+        int new_capacity = heap->capacity ? heap->capacity * 2 : TIMER_HEAP_INITIAL_CAPACITY;
+        TimerNode **new_nodes = realloc(heap->nodes, new_capacity * sizeof(TimerNode*));
+        if (!new_nodes) return -1;
+        heap->nodes = new_nodes;
+        heap->capacity = new_capacity;
+    }
+
+    node->due = due;
+    timer_heap_place(heap, node, heap->size++);
+    timer_heap_sift_up(heap, node->heap_index);
+    return 0;
+}
+
+TimerNode* timer_heap_peek(const TimerHeap *heap) {
+    return heap->size > 0 ? heap->nodes[0] : NULL;
+}
+
+TimerNode* timer_heap_pop(TimerHeap *heap) {
+    if (heap->size == 0) return NULL;
+
+    TimerNode *root = heap->nodes[0];
+    timer_heap_remove(heap, root);
+    return root;
+}
+
+// Moves a queued node to a new due time (decrease or increase key), queues it otherwise
+int timer_heap_update(TimerHeap *heap, TimerNode *node, time_t due) {
+    if (node->heap_index < 0) {
+        return timer_heap_push(heap, node, due);
+    }
+
+    time_t previous = node->due;
+    node->due = due;
+    if (due < previous) {
+        timer_heap_sift_up(heap, node->heap_index);
+    } else if (due > previous) {
+        timer_heap_sift_down(heap, node->heap_index);
+    }
+    return 0;
+}
+
+void timer_heap_remove(TimerHeap *heap, TimerNode *node) {
+    int index = node->heap_index;
+    if (index < 0 || index >= heap->size || heap->nodes[index] != node) return;
+
+    node->heap_index = -1;
+    TimerNode *last = heap->nodes[--heap->size];
+    if (last == node) return;
+
+    timer_heap_place(heap, last, index);
+    if (index > 0 && heap->nodes[(index - 1) / TIMER_HEAP_ARITY]->due > last->due) {
+        timer_heap_sift_up(heap, index);
+    } else {
+        timer_heap_sift_down(heap, index);
+    }
+}
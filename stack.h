@@ -1,5 +1,30 @@
-typedef struct stack{
-    int top;
+#ifndef CONDUIT_STACK_H
+#define CONDUIT_STACK_H
+
+#include <time.h>
+
+// Node embedded in whatever gets scheduled (Task, DAG...), owner points back to it
+typedef struct TimerNode {
+    time_t due;
+    int heap_index;  // -1 while not queued
+    void *owner;
+} TimerNode;
+
+// 4-ary min-heap of timer nodes keyed on their due time
+typedef struct TimerHeap {
+    TimerNode **nodes;
+    int size;
     int capacity;
-    int *array;
-} stack;
+} TimerHeap;
+
+void timer_node_init(TimerNode *node, void *owner);
+void timer_heap_init(TimerHeap *heap);
+void timer_heap_free(TimerHeap *heap);
+void timer_heap_clear(TimerHeap *heap);
+int timer_heap_push(TimerHeap *heap, TimerNode *node, time_t due);
+TimerNode* timer_heap_peek(const TimerHeap *heap);
+TimerNode* timer_heap_pop(TimerHeap *heap);
+int timer_heap_update(TimerHeap *heap, TimerNode *node, time_t due);
+void timer_heap_remove(TimerHeap *heap, TimerNode *node);
+
+#endif
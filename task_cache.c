@@ -0,0 +1,176 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "task_cache.h"
+#include "mongoose.h"
+#include "logger.h"
+
+#define TASK_CACHE_PATH_LENGTH 1024
+
+// Set before the executor starts, read only after that
+static char cache_dir[TASK_CACHE_PATH_LENGTH] = TASK_CACHE_DIR_DEFAULT;
+static unsigned int temp_sequence;
+
+void task_cache_set_dir(const char *dir) {
+    if (!dir || !dir[0]) return;
+    snprintf(cache_dir, sizeof(cache_dir), "%s", dir);
+}
+
+// Path, size and content, so neither a rename nor moving bytes from one file
+// to the next gives the same key
+static int hash_file(mg_sha1_ctx *context, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+
+    struct stat info;
+    if (fstat(fileno(file), &info) != 0 || !S_ISREG(info.st_mode)) {
+        fclose(file);
+        return -1;
+    }
+
+    char header[64];
+    int header_length = snprintf(header, sizeof(header), "%lld", (long long)info.st_size);
+    mg_sha1_update(context, (const unsigned char*)path, strlen(path) + 1);
+    mg_sha1_update(context, (const unsigned char*)header, header_length + 1);
+
+    unsigned char buffer[16384];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        mg_sha1_update(context, buffer, count);
+    }
+    int failed = ferror(file);
+    fclose(file);
+    return failed ? -1 : 0;
+}
+
+// The file the command's first word runs, looked up on PATH like the shell
+// does. Returns -1 for builtins and anything else that isn't a file.
+static int resolve_binary(const char *command, char *path, size_t size) {
+    command += strspn(command, " \t");
+    size_t length = strcspn(command, " \t;|&<>()");
+    if (length == 0 || length >= size) return -1;
+
+    if (memchr(command, '/', length)) {
+        snprintf(path, size, "%.*s", (int)length, command);
+        return access(path, X_OK) == 0 ? 0 : -1;
+    }
+
+    const char *search = getenv("PATH");
+    while (search && *search) {
+        size_t dir_length = strcspn(search, ":");
+        if (dir_length > 0 && dir_length + length + 2 <= size) {
+            snprintf(path, size, "%.*s/%.*s", (int)dir_length, search, (int)length, command);
+            struct stat info;
+            if (stat(path, &info) == 0 && S_ISREG(info.st_mode) && access(path, X_OK) == 0) return 0;
+        }
+        search += dir_length;
+        if (*search == ':') search++;
+    }
+    return -1;
+}
+
+int task_cache_key(const char *command, const char *inputs, char *key) {
+    mg_sha1_ctx context;
+    mg_sha1_init(&context);
+    mg_sha1_update(&context, (const unsigned char*)command, strlen(command) + 1);
+
+    // A script passed to the binary only counts when it is one of the inputs.
+    // Without the binary (an assignment, a builtin, not on PATH) a changed
+    // program would still hit, so such a task isn't cached at all.
+    char binary[TASK_CACHE_PATH_LENGTH];
+    if (resolve_binary(command, binary, sizeof(binary)) != 0) {
+        log_message("Cache: can't resolve the binary of '%s', running uncached\n", command);
+        return -1;
+    }
+    if (hash_file(&context, binary) != 0) {
+        log_message("Cache: can't read binary %s\n", binary);
+        return -1;
+    }
+
+    const char *input = inputs;
+    while (*input) {
+        size_t length = strcspn(input, "\n");
+        char path[TASK_CACHE_PATH_LENGTH];
+        if (length >= sizeof(path)) return -1;
+        memcpy(path, input, length);
+        path[length] = '\0';
+        if (hash_file(&context, path) != 0) {
+            log_message("Cache: can't read input %s\n", path);
+            return -1;
+        }
+        input += length;
+        if (*input == '\n') input++;
+    }
+
+    unsigned char digest[20];
+    mg_sha1_final(digest, &context);
+    for (int i = 0; i < 20; i++) {
+        snprintf(key + i * 2, 3, "%02x", digest[i]);
+    }
+    return 0;
+}
+
+// Written next to the target and renamed over it, so a reader never sees
+// half a file and a crash leaves the old one. from NULL writes an empty file.
+static int copy_file(const char *from, const char *to) {
+    char temp[TASK_CACHE_PATH_LENGTH + TASK_CACHE_KEY_SIZE + 64];
+    snprintf(temp, sizeof(temp), "%s.tmp.%d.%u", to, (int)getpid(),
+             __atomic_add_fetch(&temp_sequence, 1, __ATOMIC_RELAXED));
+
+    FILE *source = from ? fopen(from, "rb") : NULL;
+    if (from && !source) return -1;
+    FILE *target = fopen(temp, "wb");
+    if (!target) {
+        if (source) fclose(source);
+        return -1;
+    }
+
+    int failed = 0;
+    if (source) {
+        unsigned char buffer[16384];
+        size_t count;
+        while (!failed && (count = fread(buffer, 1, sizeof(buffer), source)) > 0) {
+            failed = fwrite(buffer, 1, count, target) != count;
+        }
+        failed |= ferror(source);
+        fclose(source);
+    }
+    failed |= fclose(target) != 0;
+
+    if (failed || rename(temp, to) != 0) {
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
+
+int task_cache_restore(const char *key, const char *output) {
+    char entry[TASK_CACHE_PATH_LENGTH + TASK_CACHE_KEY_SIZE + 1];
+    snprintf(entry, sizeof(entry), "%s/%s", cache_dir, key);
+    if (access(entry, R_OK) != 0) return 0;
+    if (!output) return 1;
+
+    if (copy_file(entry, output) != 0) {
+        log_message("Cache: failed to restore %s from entry %s\n", output, key);
+        return 0;
+    }
+    return 1;
+}
+
+int task_cache_store(const char *key, const char *output) {
+    if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+        log_message("Cache: failed to create %s: errno %d\n", cache_dir, errno);
+        return -1;
+    }
+
+    char entry[TASK_CACHE_PATH_LENGTH + TASK_CACHE_KEY_SIZE + 1];
+    snprintf(entry, sizeof(entry), "%s/%s", cache_dir, key);
+    if (copy_file(output, entry) != 0) {
+        log_message("Cache: failed to store %s as entry %s\n", output ? output : "result", key);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef CONDUIT_TASK_CACHE_H
+#define CONDUIT_TASK_CACHE_H
+
+// Results of tasks that declare their input files, addressed by content: the
+// key is the SHA-1 of the command, the binary it runs and every input, so a
+// task whose inputs didn't change is served without running it. An entry is
+// a file in the cache directory named by its key holding the task's output,
+// empty when the task declares none.
+
+// Where entries are kept, --task-cache-dir=PATH overrides it
+#define TASK_CACHE_DIR_DEFAULT "task_cache"
+// Hex SHA-1 and its terminator
+#define TASK_CACHE_KEY_SIZE 41
+
+void task_cache_set_dir(const char *dir);
+// Key of a command reading inputs, one path per line. Returns -1 when the
+// command's binary can't be resolved or an input can't be read, the task then
+// runs uncached.
+int task_cache_key(const char *command, const char *inputs, char *key);
+// Copies the entry of key to output, when output isn't NULL. Returns 1 on a
+// hit, 0 on a miss or when the output couldn't be restored.
+int task_cache_restore(const char *key, const char *output);
+// Stores output, or an empty entry when output is NULL, under key once the
+// task succeeded. Returns -1 when the entry couldn't be written.
+int task_cache_store(const char *key, const char *output);
+
+#endif
@@ -0,0 +1,1117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <cjson/cJSON.h>
+#include "task_executor.h"
+#include "logger.h"
+#include "wakeup.h"
+#include "clock_source.h"
+
+extern char **environ;
+
+// Bottom is where the owning thread pushes and pops, top where others steal
+typedef struct WorkDeque {
+    pthread_mutex_t mutex;
+    ExecutorWork **items;     // ring buffer
+    int capacity;
+    int top;
+    int count;
+} WorkDeque;
+
+// Started on first use. Idle threads sleep on work_available; pending_work
+// and idle_workers are atomic so posting only takes executor_mutex when a
+// thread is asleep.
+static pthread_mutex_t executor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_available = PTHREAD_COND_INITIALIZER;
+static int executor_state = 0;  // 0 not started, 1 running, -1 failed to start
+static WorkDeque *deques = NULL;
+static int worker_count = TASK_EXECUTOR_WORKERS_DEFAULT;
+static int pending_work = 0;
+static int idle_workers = 0;
+static unsigned int next_deque = 0;
+static __thread int current_worker = -1;
+
+// Child processes. Commands past the limit wait in a FIFO, the reaper starts
+// them as running ones exit. Both lists are guarded by process_mutex.
+static pthread_mutex_t process_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TaskJob *running_jobs = NULL;
+static int running_count = 0;
+static TaskJob *waiting_head = NULL;
+static TaskJob *waiting_tail = NULL;
+static int max_processes = TASK_EXECUTOR_PROCESSES_DEFAULT;
+static int child_pipe[2] = { -1, -1 };
+
+// Process group of a terminated command whose leader already exited. The
+// rest of the group may ignore SIGTERM, so it is kept until the grace period
+// is over and gets SIGKILL then, unless it is gone by itself.
+typedef struct LingeringGroup {
+    pid_t pgid;
+    long long kill_at_ms;
+    struct LingeringGroup *next;
+} LingeringGroup;
+
+static LingeringGroup *lingering_groups = NULL;
+
+// Commands of one owner waiting for a pool slot, oldest first
+typedef struct PoolWaiters {
+    int owner_key;
+    TaskJob *head;
+    TaskJob *tail;
+    struct PoolWaiters *next;   // ring of the owners waiting
+} PoolWaiters;
+
+// Named limit on commands running at once, shared by every owner. A command
+// holds its slot from leaving the pool's waiters until it exits. Owners
+// waiting take turns: the owner after last_served gets the next slot, owners
+// that start waiting join at the end of the round. Pools live as long as the
+// process and are guarded by process_mutex.
+typedef struct ResourcePool {
+    char *name;
+    int slots;
+    int used;
+    int waiting;
+    PoolWaiters *last_served;   // NULL when nothing waits
+    long long granted;
+    long long total_wait_ms;
+    long long max_wait_ms;
+    struct ResourcePool *next;
+} ResourcePool;
+
+static ResourcePool *pools = NULL;
+
+// Timers waiting to fire, a min-heap on due. The timer thread sleeps on the
+// clock source until the earliest one, so they follow simulated time too.
+static pthread_mutex_t timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SchedulerWakeup timer_wakeup = SCHEDULER_WAKEUP_INITIALIZER;
+static TaskJob **timers = NULL;
+static int timer_count = 0;
+static int timer_capacity = 0;
+
+// Calls waiting for the file thread, oldest first
+static pthread_mutex_t call_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t call_available = PTHREAD_COND_INITIALIZER;
+static TaskJob *calls_head = NULL;
+static TaskJob *calls_tail = NULL;
+
+static long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void task_completions_init(TaskCompletions *completions, ExecutorWork *owner) {
+    pthread_mutex_init(&completions->mutex, NULL);
+    completions->head = NULL;
+    completions->tail = NULL;
+    completions->owner = owner;
+    completions->owner_queued = 1;
+    completions->cancelled = 0;
+}
+
+void task_completions_destroy(TaskCompletions *completions) {
+    TaskJob *job = completions->head;
+    while (job) {
+        TaskJob *next = job->next;
+        task_job_free(job);
+        job = next;
+    }
+    pthread_mutex_destroy(&completions->mutex);
+}
+
+TaskJob* task_completions_take(TaskCompletions *completions) {
+    pthread_mutex_lock(&completions->mutex);
+    TaskJob *job = completions->head;
+    if (job) {
+        completions->head = job->next;
+        if (!completions->head) completions->tail = NULL;
+    } else {
+        completions->owner_queued = 0;
+    }
+    pthread_mutex_unlock(&completions->mutex);
+    return job;
+}
+
+void task_job_free(TaskJob *job) {
+    if (!job) return;
+    free(job->command);
+    free(job);
+}
+
+// Hands a finished job to its owner, posting the owner if it went idle
+static void deliver_job(TaskJob *job) {
+    if (job->exit_code != 0 && job->command) {
+        log_message("Command '%s' failed with exit code %d\n", job->command, job->exit_code);
+    }
+
+    TaskCompletions *completions = job->completions;
+    if (!completions) {
+        task_job_free(job);
+        return;
+    }
+
+    job->next = NULL;
+    pthread_mutex_lock(&completions->mutex);
+    if (completions->tail) {
+        completions->tail->next = job;
+    } else {
+        completions->head = job;
+    }
+    completions->tail = job;
+    int post = !completions->owner_queued;
+    completions->owner_queued = 1;
+    ExecutorWork *owner = completions->owner;
+    pthread_mutex_unlock(&completions->mutex);
+
+    if (post) task_executor_post(owner);
+}
+
+// Work deques
+
+static int deque_push_bottom(WorkDeque *deque, ExecutorWork *work) {
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count == deque->capacity) {
+        int capacity = deque->capacity * 2;
+        ExecutorWork **items = malloc(capacity * sizeof(ExecutorWork*));
+        if (!items) {
+            pthread_mutex_unlock(&deque->mutex);
+            return -1;
+        }
+        for (int i = 0; i < deque->count; i++) {
+            items[i] = deque->items[(deque->top + i) % deque->capacity];
+        }
+        free(deque->items);
+        deque->items = items;
+        deque->capacity = capacity;
+        deque->top = 0;
+    }
+    deque->items[(deque->top + deque->count) % deque->capacity] = work;
+    deque->count++;
+    pthread_mutex_unlock(&deque->mutex);
+    return 0;
+}
+
+static ExecutorWork* deque_pop_bottom(WorkDeque *deque) {
+    ExecutorWork *work = NULL;
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count > 0) {
+        deque->count--;
+        work = deque->items[(deque->top + deque->count) % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return work;
+}
+
+static ExecutorWork* deque_steal_top(WorkDeque *deque) {
+    ExecutorWork *work = NULL;
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count > 0) {
+        work = deque->items[deque->top];
+        deque->top = (deque->top + 1) % deque->capacity;
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    return work;
+}
+
+// Own deque first, newest work first, then the oldest work of the others
+static ExecutorWork* find_work(int self) {
+    ExecutorWork *work = deque_pop_bottom(&deques[self]);
+    for (int i = 1; !work && i < worker_count; i++) {
+        work = deque_steal_top(&deques[(self + i) % worker_count]);
+    }
+    return work;
+}
+
+static void* executor_worker(void *arg) {
+    current_worker = (int)(long)arg;
+
+    for (;;) {
+        ExecutorWork *work = find_work(current_worker);
+        if (work) {
+            __atomic_sub_fetch(&pending_work, 1, __ATOMIC_SEQ_CST);
+            work->run(work->arg);
+            continue;
+        }
+
+        // Announce the sleep before the last look at pending_work, a post
+        // either sees this thread idle or its work is seen here
+        pthread_mutex_lock(&executor_mutex);
+        __atomic_add_fetch(&idle_workers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pending_work, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&work_available, &executor_mutex);
+        }
+        __atomic_sub_fetch(&idle_workers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&executor_mutex);
+    }
+    return NULL;
+}
+
+// Child processes
+
+// Wakes the reaper, from the SIGCHLD handler or when a new deadline is set
+static void poke_reaper(void) {
+    int saved_errno = errno;
+    char byte = 0;
+    ssize_t written = write(child_pipe[1], &byte, 1);
+    (void)written;
+    errno = saved_errno;
+}
+
+static void on_child_exit(int signal_number) {
+    (void)signal_number;
+    poke_reaper();
+}
+
+// Signals the command's whole process group
+static void signal_job(TaskJob *job, int signal_number) {
+    if (kill(-job->pid, signal_number) != 0 && errno != ESRCH) {
+        log_message("Failed to signal command '%s': %s\n", job->command, strerror(errno));
+    }
+}
+
+// SIGTERM now, SIGKILL once the grace period is over. Caller holds process_mutex.
+static void terminate_job_locked(TaskJob *job, long long now_ms) {
+    if (job->term_sent) return;
+    signal_job(job, SIGTERM);
+    job->term_sent = 1;
+    job->signal_at_ms = now_ms + TASK_EXECUTOR_KILL_GRACE_MS;
+    poke_reaper();
+}
+
+// The leader of a command that got SIGTERM was reaped before its SIGKILL was
+// due. Caller holds process_mutex.
+static void linger_group_locked(TaskJob *job) {
+    LingeringGroup *group = malloc(sizeof(LingeringGroup));
+    if (!group) {
+        signal_job(job, SIGKILL);
+        return;
+    }
+    group->pgid = job->pid;
+    group->kill_at_ms = job->signal_at_ms;
+    group->next = lingering_groups;
+    lingering_groups = group;
+}
+
+// Caller holds process_mutex. Failed starts get exit_code -1 and are left
+// for the caller to deliver.
+static int start_job_locked(TaskJob *job) {
+    posix_spawnattr_t attributes;
+    sigset_t no_signals;
+    sigemptyset(&no_signals);
+    posix_spawnattr_init(&attributes);
+    // Own process group, so the whole tree of a command can be signalled
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setsigmask(&attributes, &no_signals);
+
+    char *shell_argv[] = { "sh", "-c", job->command, NULL };
+    char *direct_argv[] = { job->command, NULL };
+
+    log_message("Executing command: %s\n", job->command);
+    job->started_ms = monotonic_ms();
+    int rc = posix_spawn(&job->pid, job->direct ? job->command : "/bin/sh", NULL, &attributes,
+                         job->direct ? direct_argv : shell_argv, environ);
+    posix_spawnattr_destroy(&attributes);
+    if (rc != 0) {
+        log_message("Failed to start command '%s': %s\n", job->command, strerror(rc));
+        job->exit_code = -1;
+        job->duration_ms = 0;
+        return -1;
+    }
+
+    job->next = running_jobs;
+    running_jobs = job;
+    running_count++;
+    if (job->timeout_ms > 0) {
+        job->signal_at_ms = job->started_ms + job->timeout_ms;
+        poke_reaper();
+    }
+    return 0;
+}
+
+static void wait_for_process_locked(TaskJob *job) {
+    job->next = NULL;
+    if (waiting_tail) {
+        waiting_tail->next = job;
+    } else {
+        waiting_head = job;
+    }
+    waiting_tail = job;
+}
+
+// Resource pools
+
+static ResourcePool* find_pool_locked(const char *name) {
+    for (ResourcePool *pool = pools; pool; pool = pool->next) {
+        if (strcmp(pool->name, name) == 0) return pool;
+    }
+    return NULL;
+}
+
+static void grant_pool_slot_locked(ResourcePool *pool, TaskJob *job, long long now_ms) {
+    long long waited = job->pool_queued_ms ? now_ms - job->pool_queued_ms : 0;
+    pool->used++;
+    pool->granted++;
+    pool->total_wait_ms += waited;
+    if (waited > pool->max_wait_ms) pool->max_wait_ms = waited;
+    wait_for_process_locked(job);
+}
+
+static void wait_for_pool_locked(ResourcePool *pool, TaskJob *job) {
+    PoolWaiters *waiters = NULL;
+    if (pool->last_served) {
+        waiters = pool->last_served;
+        do {
+            if (waiters->owner_key == job->owner_key) break;
+            waiters = waiters->next;
+        } while (waiters != pool->last_served);
+        if (waiters->owner_key != job->owner_key) waiters = NULL;
+    }
+
+    if (!waiters) {
+        waiters = calloc(1, sizeof(PoolWaiters));
+        if (!waiters) {
+            // Nothing to queue it under, it runs past the limit instead
+            log_message("Failed to queue command '%s' for pool %s, starting it anyway\n", job->command, pool->name);
+            grant_pool_slot_locked(pool, job, monotonic_ms());
+            return;
+        }
+        waiters->owner_key = job->owner_key;
+        if (pool->last_served) {
+            waiters->next = pool->last_served->next;
+            pool->last_served->next = waiters;
+        } else {
+            waiters->next = waiters;
+        }
+        pool->last_served = waiters;
+    }
+
+    job->pool_queued_ms = monotonic_ms();
+    job->next = NULL;
+    if (waiters->tail) {
+        waiters->tail->next = job;
+    } else {
+        waiters->head = job;
+    }
+    waiters->tail = job;
+    pool->waiting++;
+}
+
+// Hands free slots to the waiting owners in turn
+static void fill_pool_locked(ResourcePool *pool) {
+    long long now_ms = monotonic_ms();
+    while (pool->last_served && pool->used < pool->slots) {
+        PoolWaiters *previous = pool->last_served;
+        PoolWaiters *waiters = previous->next;
+        TaskJob *job = waiters->head;
+        waiters->head = job->next;
+        pool->waiting--;
+
+        if (waiters->head) {
+            pool->last_served = waiters;
+        } else {
+            if (waiters == previous) {
+                pool->last_served = NULL;
+            } else {
+                previous->next = waiters->next;
+            }
+            free(waiters);
+        }
+        grant_pool_slot_locked(pool, job, now_ms);
+    }
+}
+
+static void release_pool_slot_locked(TaskJob *job) {
+    if (!job->pool) return;
+    job->pool->used--;
+    fill_pool_locked(job->pool);
+    job->pool = NULL;
+}
+
+// Takes the owner's commands out of every pool's waiters
+static void remove_pool_waiters_locked(TaskCompletions *completions, TaskJob **removed) {
+    for (ResourcePool *pool = pools; pool; pool = pool->next) {
+        PoolWaiters *previous = pool->last_served;
+        if (!previous) continue;
+
+        int remaining = 0;
+        PoolWaiters *waiters = previous->next;
+        for (;;) {
+            PoolWaiters *next = waiters->next;
+            int last = waiters == pool->last_served;
+            TaskJob **link = &waiters->head;
+            waiters->tail = NULL;
+            while (*link) {
+                TaskJob *job = *link;
+                if (job->completions != completions) {
+                    waiters->tail = job;
+                    link = &job->next;
+                    continue;
+                }
+                *link = job->next;
+                job->pool = NULL;
+                job->next = *removed;
+                *removed = job;
+                pool->waiting--;
+            }
+
+            if (waiters->head) {
+                remaining = 1;
+                previous = waiters;
+            } else {
+                previous->next = next;
+                if (last) pool->last_served = previous;
+                free(waiters);
+            }
+            if (last) break;
+            waiters = next;
+        }
+        if (!remaining) pool->last_served = NULL;
+    }
+}
+
+// Starts waiting jobs while slots are free, failed starts go to failed
+static void start_waiting_locked(TaskJob **failed) {
+    while (waiting_head && running_count < max_processes) {
+        TaskJob *job = waiting_head;
+        waiting_head = job->next;
+        if (!waiting_head) waiting_tail = NULL;
+        if (start_job_locked(job) != 0) {
+            release_pool_slot_locked(job);
+            job->next = *failed;
+            *failed = job;
+        }
+    }
+}
+
+// Sends the signals that are due: SIGTERM to commands past their timeout,
+// SIGKILL to those still running after the grace period, and to the groups
+// of those whose leader exited meanwhile. Returns how long
+// until the next one is due, -1 when none is.
+static int signal_overdue_locked(long long now_ms) {
+    long long next_ms = -1;
+    for (TaskJob *job = running_jobs; job; job = job->next) {
+        if (!job->signal_at_ms) continue;
+        if (job->signal_at_ms <= now_ms) {
+            if (!job->term_sent) {
+                log_message("Command '%s' timed out after %ld ms\n", job->command, job->timeout_ms);
+                job->timed_out = 1;
+                terminate_job_locked(job, now_ms);
+            } else {
+                log_message("Command '%s' still running after SIGTERM, killing it\n", job->command);
+                signal_job(job, SIGKILL);
+                job->signal_at_ms = 0;
+                continue;
+            }
+        }
+        if (next_ms < 0 || job->signal_at_ms < next_ms) next_ms = job->signal_at_ms;
+    }
+
+    LingeringGroup **link = &lingering_groups;
+    while (*link) {
+        LingeringGroup *group = *link;
+        if (kill(-group->pgid, 0) != 0 && errno == ESRCH) {
+            *link = group->next;
+            free(group);
+            continue;
+        }
+        if (group->kill_at_ms <= now_ms) {
+            log_message("Process group %d still running after SIGTERM, killing it\n", (int)group->pgid);
+            if (kill(-group->pgid, SIGKILL) != 0 && errno != ESRCH) {
+                log_message("Failed to kill process group %d: %s\n", (int)group->pgid, strerror(errno));
+            }
+            *link = group->next;
+            free(group);
+            continue;
+        }
+        if (next_ms < 0 || group->kill_at_ms < next_ms) next_ms = group->kill_at_ms;
+        link = &group->next;
+    }
+    return next_ms < 0 ? -1 : (int)(next_ms - now_ms);
+}
+
+// Collects exited children whenever SIGCHLD pokes the pipe, then fills the
+// freed slots and signals overdue commands. Only pids it started are waited for.
+static void* child_reaper(void *arg) {
+    (void)arg;
+
+    int wait_ms = -1;
+    for (;;) {
+        struct pollfd wake = { child_pipe[0], POLLIN, 0 };
+        if (poll(&wake, 1, wait_ms) < 0 && errno != EINTR) {
+            log_message("Child reaper poll failed: %s\n", strerror(errno));
+        }
+        char drain[64];
+        while (read(child_pipe[0], drain, sizeof(drain)) > 0) {
+        }
+
+        TaskJob *finished = NULL;
+        pthread_mutex_lock(&process_mutex);
+        long long now_ms = monotonic_ms();
+        TaskJob **link = &running_jobs;
+        while (*link) {
+            TaskJob *job = *link;
+            int status;
+            if (waitpid(job->pid, &status, WNOHANG) != job->pid) {
+                link = &job->next;
+                continue;
+            }
+            *link = job->next;
+            running_count--;
+            if (job->term_sent && job->signal_at_ms) linger_group_locked(job);
+            release_pool_slot_locked(job);
+            job->exit_code = status;
+            job->duration_ms = now_ms - job->started_ms;
+            job->next = finished;
+            finished = job;
+        }
+        start_waiting_locked(&finished);
+        wait_ms = signal_overdue_locked(monotonic_ms());
+        pthread_mutex_unlock(&process_mutex);
+
+        while (finished) {
+            TaskJob *next = finished->next;
+            deliver_job(finished);
+            finished = next;
+        }
+    }
+    return NULL;
+}
+
+// Timers
+
+static int timespec_before(const struct timespec *a, const struct timespec *b) {
+    if (a->tv_sec != b->tv_sec) return a->tv_sec < b->tv_sec;
+    return a->tv_nsec < b->tv_nsec;
+}
+
+static void timer_sift_down_locked(int position) {
+    TaskJob *job = timers[position];
+    for (;;) {
+        int child = 2 * position + 1;
+        if (child >= timer_count) break;
+        if (child + 1 < timer_count && timespec_before(&timers[child + 1]->due, &timers[child]->due)) child++;
+        if (!timespec_before(&timers[child]->due, &job->due)) break;
+        timers[position] = timers[child];
+        position = child;
+    }
+    timers[position] = job;
+}
+
+static int timer_push_locked(TaskJob *job) {
+    if (timer_count == timer_capacity) {
+        int capacity = timer_capacity ? timer_capacity * 2 : 64;
+        TaskJob **grown = realloc(timers, capacity * sizeof(TaskJob*));
+        if (!grown) return -1;
+        timers = grown;
+        timer_capacity = capacity;
+    }
+
+    int position = timer_count++;
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!timespec_before(&job->due, &timers[parent]->due)) break;
+        timers[position] = timers[parent];
+        position = parent;
+    }
+    timers[position] = job;
+    return 0;
+}
+
+static TaskJob* timer_pop_locked(void) {
+    TaskJob *top = timers[0];
+    timers[0] = timers[--timer_count];
+    if (timer_count > 0) timer_sift_down_locked(0);
+    return top;
+}
+
+// Takes the owner's timers out of the heap and rebuilds it
+static void remove_timers_locked(TaskCompletions *completions, TaskJob **removed) {
+    int kept = 0;
+    for (int i = 0; i < timer_count; i++) {
+        TaskJob *job = timers[i];
+        if (job->completions == completions) {
+            job->next = *removed;
+            *removed = job;
+        } else {
+            timers[kept++] = job;
+        }
+    }
+    timer_count = kept;
+    for (int i = timer_count / 2 - 1; i >= 0; i--) {
+        timer_sift_down_locked(i);
+    }
+}
+
+// Fires due timers. It stays attached to the clock for good, and attaches
+// once more for every job it hands back, so virtual time can't move on
+// before the owner has seen it.
+static void* timer_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&timer_mutex);
+    for (;;) {
+        struct timespec deadline;
+        if (timer_count > 0) deadline = timers[0]->due;
+        if (!wakeup_wait(&timer_wakeup, &timer_mutex, timer_count > 0 ? &deadline : NULL)) continue;
+
+        struct timespec now;
+        clock_now_precise(&now);
+        TaskJob *expired = NULL;
+        while (timer_count > 0 && !timespec_before(&now, &timers[0]->due)) {
+            TaskJob *job = timer_pop_locked();
+            clock_source_attach();
+            job->exit_code = 0;
+            job->next = expired;
+            expired = job;
+        }
+        pthread_mutex_unlock(&timer_mutex);
+
+        while (expired) {
+            TaskJob *next = expired->next;
+            deliver_job(expired);
+            expired = next;
+        }
+        pthread_mutex_lock(&timer_mutex);
+    }
+    return NULL;
+}
+
+// File thread
+
+static void* call_thread(void *arg) {
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&call_mutex);
+        while (!calls_head) {
+            pthread_cond_wait(&call_available, &call_mutex);
+        }
+        TaskJob *job = calls_head;
+        calls_head = job->next;
+        if (!calls_head) calls_tail = NULL;
+        pthread_mutex_unlock(&call_mutex);
+
+        job->call(job);
+        deliver_job(job);
+    }
+    return NULL;
+}
+
+// Takes the owner's calls that haven't run out of the queue
+static void take_calls(TaskCompletions *completions, TaskJob **taken) {
+    pthread_mutex_lock(&call_mutex);
+    TaskJob **link = &calls_head;
+    calls_tail = NULL;
+    while (*link) {
+        TaskJob *job = *link;
+        if (job->completions != completions) {
+            calls_tail = job;
+            link = &job->next;
+            continue;
+        }
+        *link = job->next;
+        job->next = *taken;
+        *taken = job;
+    }
+    pthread_mutex_unlock(&call_mutex);
+}
+
+static int start_executor_locked(void) {
+    if (pipe(child_pipe) != 0) {
+        log_message("Failed to create child process pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(child_pipe[i], F_SETFL, fcntl(child_pipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(child_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_child_exit;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, child_reaper, NULL) != 0) {
+        log_message("Failed to start child reaper\n");
+        return -1;
+    }
+    pthread_detach(thread);
+
+    clock_source_attach();
+    if (pthread_create(&thread, NULL, timer_thread, NULL) != 0) {
+        clock_source_detach();
+        log_message("Failed to start executor timer thread\n");
+        return -1;
+    }
+    pthread_detach(thread);
+
+    if (pthread_create(&thread, NULL, call_thread, NULL) != 0) {
+        log_message("Failed to start executor file thread\n");
+        return -1;
+    }
+    pthread_detach(thread);
+
+    deques = calloc(worker_count, sizeof(WorkDeque));
+    if (!deques) {
+        log_message("Failed to allocate executor deques\n");
+        return -1;
+    }
+    for (int i = 0; i < worker_count; i++) {
+        pthread_mutex_init(&deques[i].mutex, NULL);
+        deques[i].capacity = 64;
+        deques[i].items = malloc(deques[i].capacity * sizeof(ExecutorWork*));
+        if (!deques[i].items) {
+            log_message("Failed to allocate executor deques\n");
+            return -1;
+        }
+    }
+
+    // Threads that failed to start only leave their deque to be stolen from
+    int started = 0;
+    for (int i = 0; i < worker_count; i++) {
+        if (pthread_create(&thread, NULL, executor_worker, (void*)(long)i) == 0) {
+            pthread_detach(thread);
+            started++;
+        }
+    }
+    if (started == 0) {
+        log_message("Failed to start executor workers\n");
+        return -1;
+    }
+
+    log_message("Task executor started with %d workers, %d processes at once\n", started, max_processes);
+    return 0;
+}
+
+static int ensure_started(void) {
+    int state = __atomic_load_n(&executor_state, __ATOMIC_ACQUIRE);
+    if (state != 0) return state;
+
+    pthread_mutex_lock(&executor_mutex);
+    if (executor_state == 0) {
+        __atomic_store_n(&executor_state, start_executor_locked() == 0 ? 1 : -1, __ATOMIC_RELEASE);
+    }
+    state = executor_state;
+    pthread_mutex_unlock(&executor_mutex);
+    return state;
+}
+
+int task_executor_post(ExecutorWork *work) {
+    if (ensure_started() < 0) return -1;
+
+    int target = current_worker >= 0 ? current_worker
+                                     : (int)(__atomic_fetch_add(&next_deque, 1, __ATOMIC_RELAXED) % worker_count);
+    if (deque_push_bottom(&deques[target], work) != 0) {
+        log_message("Failed to queue executor work\n");
+        return -1;
+    }
+
+    __atomic_add_fetch(&pending_work, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&idle_workers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&executor_mutex);
+        pthread_cond_signal(&work_available);
+        pthread_mutex_unlock(&executor_mutex);
+    }
+    return 0;
+}
+
+static int spawn_job(TaskCompletions *completions, int tag, const char *command, int direct,
+                     const char *pool_name, int owner_key, int timeout_seconds) {
+    if (ensure_started() < 0) return -1;
+
+    TaskJob *job = calloc(1, sizeof(TaskJob));
+    if (!job || !(job->command = strdup(command))) {
+        log_message("Failed to allocate executor job\n");
+        free(job);
+        return -1;
+    }
+    job->tag = tag;
+    job->direct = direct;
+    job->exit_code = -1;
+    job->duration_ms = -1;
+    job->owner_key = owner_key;
+    job->timeout_ms = timeout_seconds > 0 ? timeout_seconds * 1000L : 0;
+    job->completions = completions;
+
+    TaskJob *failed = NULL;
+    pthread_mutex_lock(&process_mutex);
+    ResourcePool *pool = pool_name ? find_pool_locked(pool_name) : NULL;
+    if (pool_name && !pool) {
+        log_message("Pool %s doesn't exist, command '%s' runs without one\n", pool_name, command);
+    }
+
+    if (completions && __atomic_load_n(&completions->cancelled, __ATOMIC_ACQUIRE)) {
+        // Cancelled while the owner was still starting it
+        job->next = NULL;
+        failed = job;
+    } else if (!pool) {
+        wait_for_process_locked(job);
+    } else {
+        job->pool = pool;
+        // Only jump ahead of nobody
+        if (!pool->last_served && pool->used < pool->slots) {
+            grant_pool_slot_locked(pool, job, monotonic_ms());
+        } else {
+            wait_for_pool_locked(pool, job);
+        }
+    }
+    start_waiting_locked(&failed);
+    pthread_mutex_unlock(&process_mutex);
+
+    while (failed) {
+        TaskJob *next = failed->next;
+        deliver_job(failed);
+        failed = next;
+    }
+    return 0;
+}
+
+int task_executor_spawn(TaskCompletions *completions, int tag, const char *command, const char *pool,
+                        int owner_key, int timeout_seconds) {
+    return spawn_job(completions, tag, command, 0, pool, owner_key, timeout_seconds);
+}
+
+int task_executor_deliver_after(TaskCompletions *completions, int tag, long delay_ms) {
+    if (ensure_started() < 0) return -1;
+
+    TaskJob *job = calloc(1, sizeof(TaskJob));
+    if (!job) {
+        log_message("Failed to allocate executor timer\n");
+        return -1;
+    }
+    job->tag = tag;
+    job->timer = 1;
+    job->exit_code = -1;
+    job->duration_ms = -1;
+    job->completions = completions;
+    clock_now_precise(&job->due);
+    job->due.tv_sec += delay_ms / 1000;
+    job->due.tv_nsec += (delay_ms % 1000) * 1000000L;
+    if (job->due.tv_nsec >= 1000000000L) {
+        job->due.tv_sec++;
+        job->due.tv_nsec -= 1000000000L;
+    }
+
+    // task_executor_cancel sets the flag before it looks at the timers
+    pthread_mutex_lock(&timer_mutex);
+    if (__atomic_load_n(&completions->cancelled, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_unlock(&timer_mutex);
+        clock_source_attach();
+        deliver_job(job);
+        return 0;
+    }
+    if (timer_push_locked(job) != 0) {
+        pthread_mutex_unlock(&timer_mutex);
+        log_message("Failed to queue executor timer\n");
+        free(job);
+        return -1;
+    }
+    if (timers[0] == job) wakeup_notify(&timer_wakeup);
+    pthread_mutex_unlock(&timer_mutex);
+    return 0;
+}
+
+int task_executor_call(TaskCompletions *completions, int tag, void (*call)(TaskJob *job), void *arg) {
+    if (ensure_started() < 0) return -1;
+
+    TaskJob *job = calloc(1, sizeof(TaskJob));
+    if (!job) {
+        log_message("Failed to allocate executor call\n");
+        return -1;
+    }
+    job->tag = tag;
+    job->call = call;
+    job->arg = arg;
+    job->exit_code = -1;
+    job->duration_ms = -1;
+    job->completions = completions;
+
+    // task_executor_cancel sets the flag before it looks at the calls
+    pthread_mutex_lock(&call_mutex);
+    if (__atomic_load_n(&completions->cancelled, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_unlock(&call_mutex);
+        deliver_job(job);
+        return 0;
+    }
+    if (calls_tail) {
+        calls_tail->next = job;
+    } else {
+        calls_head = job;
+    }
+    calls_tail = job;
+    pthread_cond_signal(&call_available);
+    pthread_mutex_unlock(&call_mutex);
+    return 0;
+}
+
+int task_executor_spawn_binary(const char *path) {
+    return spawn_job(NULL, 0, path, 1, NULL, 0, 0);
+}
+
+// The owner's timers come back unfired, holding the clock like fired ones
+static void take_timers(TaskCompletions *completions, TaskJob **taken) {
+    TaskJob *removed = NULL;
+    pthread_mutex_lock(&timer_mutex);
+    remove_timers_locked(completions, &removed);
+    pthread_mutex_unlock(&timer_mutex);
+
+    while (removed) {
+        TaskJob *job = removed;
+        removed = job->next;
+        clock_source_attach();
+        job->next = *taken;
+        *taken = job;
+    }
+}
+
+void task_executor_cancel(TaskCompletions *completions) {
+    TaskJob *cancelled = NULL;
+    pthread_mutex_lock(&process_mutex);
+    __atomic_store_n(&completions->cancelled, 1, __ATOMIC_RELEASE);
+
+    long long now_ms = monotonic_ms();
+    for (TaskJob *job = running_jobs; job; job = job->next) {
+        if (job->completions == completions) terminate_job_locked(job, now_ms);
+    }
+
+    remove_pool_waiters_locked(completions, &cancelled);
+    TaskJob *granted = NULL;
+    TaskJob **link = &waiting_head;
+    waiting_tail = NULL;
+    while (*link) {
+        TaskJob *job = *link;
+        if (job->completions != completions) {
+            waiting_tail = job;
+            link = &job->next;
+            continue;
+        }
+        *link = job->next;
+        job->next = granted;
+        granted = job;
+    }
+
+    // Their pool slots go to the next waiters, who may start right away
+    while (granted) {
+        TaskJob *job = granted;
+        granted = job->next;
+        release_pool_slot_locked(job);
+        job->next = cancelled;
+        cancelled = job;
+    }
+    start_waiting_locked(&cancelled);
+    pthread_mutex_unlock(&process_mutex);
+
+    take_timers(completions, &cancelled);
+    take_calls(completions, &cancelled);
+
+    while (cancelled) {
+        TaskJob *next = cancelled->next;
+        deliver_job(cancelled);
+        cancelled = next;
+    }
+}
+
+void task_executor_set_workers(int workers) {
+    if (workers < 1) workers = 1;
+
+    pthread_mutex_lock(&executor_mutex);
+    if (executor_state == 0) {
+        worker_count = workers;
+        log_message("Task executor will use %d workers\n", workers);
+    } else {
+        log_message("Task executor already started, keeping %d workers\n", worker_count);
+    }
+    pthread_mutex_unlock(&executor_mutex);
+}
+
+// Lowering the limit lets running commands finish, only new starts wait
+void task_executor_set_max_processes(int processes) {
+    if (processes < 1) processes = 1;
+
+    pthread_mutex_lock(&process_mutex);
+    max_processes = processes;
+    pthread_mutex_unlock(&process_mutex);
+    log_message("Task executor limited to %d processes at once\n", processes);
+}
+
+int task_executor_set_pool(const char *name, int slots) {
+    TaskJob *failed = NULL;
+    pthread_mutex_lock(&process_mutex);
+    ResourcePool *pool = find_pool_locked(name);
+    if (!pool) {
+        pool = calloc(1, sizeof(ResourcePool));
+        if (!pool || !(pool->name = strdup(name))) {
+            pthread_mutex_unlock(&process_mutex);
+            log_message("Failed to allocate pool %s\n", name);
+            free(pool);
+            return -1;
+        }
+        pool->next = pools;
+        pools = pool;
+    }
+    // Lowering the slots lets running commands finish, like the process limit
+    pool->slots = slots;
+    fill_pool_locked(pool);
+    start_waiting_locked(&failed);
+    pthread_mutex_unlock(&process_mutex);
+
+    while (failed) {
+        TaskJob *next = failed->next;
+        deliver_job(failed);
+        failed = next;
+    }
+    log_message("Pool %s has %d slots\n", name, slots);
+    return 0;
+}
+
+char* task_executor_pools_json(void) {
+    cJSON *response = cJSON_CreateObject();
+    cJSON *list = response ? cJSON_AddArrayToObject(response, "pools") : NULL;
+    if (!list) {
+        cJSON_Delete(response);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&process_mutex);
+    long long now_ms = monotonic_ms();
+    for (ResourcePool *pool = pools; pool; pool = pool->next) {
+        // The heads are the oldest waiter of each owner
+        long long oldest_wait_ms = 0;
+        PoolWaiters *waiters = pool->last_served;
+        for (int i = 0; waiters && (i == 0 || waiters != pool->last_served); i++, waiters = waiters->next) {
+            long long waited = now_ms - waiters->head->pool_queued_ms;
+            if (waited > oldest_wait_ms) oldest_wait_ms = waited;
+        }
+
+        cJSON *entry = cJSON_CreateObject();
+        if (!entry) break;
+        cJSON_AddItemToArray(list, entry);
+        cJSON_AddStringToObject(entry, "name", pool->name);
+        cJSON_AddNumberToObject(entry, "slots", pool->slots);
+        cJSON_AddNumberToObject(entry, "used", pool->used);
+        cJSON_AddNumberToObject(entry, "waiting", pool->waiting);
+        cJSON_AddNumberToObject(entry, "granted", (double)pool->granted);
+        cJSON_AddNumberToObject(entry, "avg_wait_ms",
+                                pool->granted ? (double)(pool->total_wait_ms / pool->granted) : 0);
+        cJSON_AddNumberToObject(entry, "max_wait_ms", (double)pool->max_wait_ms);
+        cJSON_AddNumberToObject(entry, "oldest_wait_ms", (double)oldest_wait_ms);
+    }
+    pthread_mutex_unlock(&process_mutex);
+
+    char *json_result = cJSON_PrintUnformatted(response);
+    cJSON_Delete(response);
+    return json_result;
+}
@@ -0,0 +1,117 @@
+#ifndef CONDUIT_TASK_EXECUTOR_H
+#define CONDUIT_TASK_EXECUTOR_H
+
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Threads advancing DAG runs, --executor-workers=N overrides it
+#define TASK_EXECUTOR_WORKERS_DEFAULT 4
+// Task commands running at once across all runs, --max-task-processes=N overrides it
+#define TASK_EXECUTOR_PROCESSES_DEFAULT 64
+// A command still running this long after SIGTERM gets SIGKILL
+#define TASK_EXECUTOR_KILL_GRACE_MS 5000
+
+// Something for the executor threads to do. Each thread has its own deque:
+// work posted from an executor thread goes to the bottom of its deque and is
+// taken from there first, idle threads steal from the top of the others.
+// Work posted from any other thread is spread over the deques in turn.
+typedef struct ExecutorWork {
+    void (*run)(void *arg);
+    void *arg;
+} ExecutorWork;
+
+struct TaskCompletions;
+struct ResourcePool;
+
+// One command run as a child process in its own process group. Once it
+// exits the job is handed back through its completions, jobs without
+// completions are only logged and freed. Timers are jobs without a command
+// handed back once they are due, calls ones handed back once their function
+// ran on the file thread.
+typedef struct TaskJob {
+    int tag;                      // caller's handle for the task
+    int timer;                    // set by task_executor_deliver_after, ran nothing
+    struct timespec due;          // when a timer fires, on the clock source
+    void (*call)(struct TaskJob *job);  // set by task_executor_call
+    void *arg;                    // caller's argument of call
+    char *command;
+    int direct;                   // command is a binary to exec, not a shell line
+    pid_t pid;
+    int exit_code;                // wait status, 0 on success, -1 when it couldn't start
+    long duration_ms;             // wall time the command ran
+    long long started_ms;
+    long timeout_ms;              // wall time allowed once started, 0 for no limit
+    long long signal_at_ms;       // when the next signal is due, 0 for none
+    int term_sent;                // SIGTERM went out, SIGKILL follows at signal_at_ms
+    int timed_out;
+    struct ResourcePool *pool;    // holding or waiting for one of its slots, NULL when unpooled
+    int owner_key;                // pool waiters with the same key are served in turn
+    long long pool_queued_ms;
+    struct TaskCompletions *completions;
+    struct TaskJob *next;
+} TaskJob;
+
+// Finished jobs of one owner, a DAG run, in the order they finished. The
+// owner counts as queued from init, whoever creates it posts it once. After
+// that a job arriving while the owner isn't queued posts it again, so the
+// owner never runs on two threads at once and never waits on a thread.
+typedef struct TaskCompletions {
+    pthread_mutex_t mutex;
+    TaskJob *head;
+    TaskJob *tail;
+    ExecutorWork *owner;
+    int owner_queued;
+    int cancelled;      // set by task_executor_cancel, read with __atomic_load_n
+} TaskCompletions;
+
+void task_completions_init(TaskCompletions *completions, ExecutorWork *owner);
+void task_completions_destroy(TaskCompletions *completions);
+// Next finished job, free it with task_job_free. NULL when there is none,
+// the owner then stops counting as queued and must return without touching
+// the completions again: the next job may already be running it elsewhere.
+TaskJob* task_completions_take(TaskCompletions *completions);
+void task_job_free(TaskJob *job);
+
+// Returns -1 when the executor threads couldn't be started
+int task_executor_post(ExecutorWork *work);
+// Starts the command once a process slot is free, and first a slot of the
+// named pool when pool isn't NULL. Commands waiting for a pool are served one
+// owner_key at a time in turn, so a DAG with many tasks can't starve the
+// others. A pool that doesn't exist limits nothing. A command still running
+// timeout_seconds after it started (0 = no limit) gets SIGTERM and then
+// SIGKILL and comes back with timed_out set. Returns -1 when the job could
+// not be queued.
+int task_executor_spawn(TaskCompletions *completions, int tag, const char *command, const char *pool,
+                        int owner_key, int timeout_seconds);
+// Hands back a timer job tagged tag through the completions once delay_ms
+// passed on the clock source (clock_source.h), so an owner can wait without
+// holding a thread or a process slot. From firing until the owner has taken
+// it the job keeps the clock attached, the owner detaches it then. Returns -1
+// when the timer couldn't be set.
+int task_executor_deliver_after(TaskCompletions *completions, int tag, long delay_ms);
+// Runs call on the executor's file thread and hands the job back tagged tag
+// through the completions, for file work like hashing or copying that would
+// otherwise hold an executor thread. call sets job->exit_code, which starts
+// at -1. Calls run one at a time in the order they were made. Returns -1 when
+// the call couldn't be queued.
+int task_executor_call(TaskCompletions *completions, int tag, void (*call)(TaskJob *job), void *arg);
+// Runs a binary without a shell, fire and forget
+int task_executor_spawn_binary(const char *path);
+// Sends SIGTERM to the process groups of the owner's running commands,
+// SIGKILL if they are still there after the grace period, and hands back
+// the waiting ones, its timers, the calls that haven't run and any spawned,
+// set or called later with exit_code -1
+void task_executor_cancel(TaskCompletions *completions);
+
+// The worker count only applies before the executor starts, the process
+// limit applies to the next command started
+void task_executor_set_workers(int workers);
+void task_executor_set_max_processes(int processes);
+// Creates the pool or changes its slots, commands waiting for it start as
+// soon as slots are free. Returns -1 when out of memory.
+int task_executor_set_pool(const char *name, int slots);
+// Slots, occupancy and wait times of every pool for /api/pools, caller frees
+char* task_executor_pools_json(void);
+
+#endif
@@ -8,6 +8,7 @@
 #include "hash.h"
 #include "webserver.h"
 #include "logger.h"
+#include "clock_source.h"
 
 void *thread_scheduler_function(void *arg) {
     sqlite3 *db = (sqlite3 *)arg;
@@ -15,19 +16,6 @@ void *thread_scheduler_function(void *arg) {
     return NULL;
 }
 
-void *thread_worker_function(void *arg) {
-    ThreadParams* params = (ThreadParams*)arg;
-
-    // Now you can use the parameters
-    log_message("Worker processing task ID: %d, execution: %s\n",
-            params->taskId, params->taskExecution);
-
-    worker(params->taskId, params->taskExecution);
-
-    free(params);
-    return NULL;
-}
-
 void *thread_webserver_function(void *arg) {
     sqlite3 *db = (sqlite3 *)arg;
     initialize_webserver(db);
@@ -37,6 +25,7 @@ void *thread_webserver_function(void *arg) {
 void start_scheduler_thread(sqlite3 *db) {
     pthread_t thread_id;
 
+    clock_source_attach();
     if (pthread_create(&thread_id, NULL, thread_scheduler_function, db) != 0) {
         perror("Failed to create thread");
         exit(EXIT_FAILURE);
@@ -60,33 +49,14 @@ void start_webserver_thread(sqlite3 *db) {
     return;
 }
 
-void spawn_worker_thread(Task *task) {
-    pthread_t thread_id;
-
+// Legacy tasks run on the shared task executor instead of a thread each
+void spawn_worker_task(Task *task) {
     if (task == NULL) {
-           log_message("Error: Task is NULL\n");
-           return;
-       }
-
-       ThreadParams* params = malloc(sizeof(ThreadParams));
-       if (params == NULL) {
-           perror("Failed to allocate memory for thread parameters");
-           exit(EXIT_FAILURE);
-    }
-
-    int taskId = 0;
-    taskId = hashString(task->taskName);
-    params->taskId = taskId;
-    strcpy(params->taskExecution, task->taskExecution);
-
-    if (pthread_create(&thread_id, NULL, thread_worker_function, params) != 0) {
-        perror("Failed to create worker thread");
-        free(params);
-        exit(EXIT_FAILURE);
+        log_message("Error: Task is NULL\n");
+        return;
     }
-    pthread_detach(thread_id);
 
-    log_message("Worker thread start with ID: %ld\n", (unsigned long)thread_id);
-
-    return;
+    int taskId = hashString(task->taskName);
+    log_message("Worker processing task ID: %d, execution: %s\n", taskId, task->taskExecution);
+    worker(taskId, task->taskExecution);
 }
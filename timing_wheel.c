@@ -0,0 +1,186 @@
+#include <stddef.h>
+#include "timing_wheel.h"
+
+static const int wheel_level_slots[TIMING_WHEEL_LEVELS] = {
+    TIMING_WHEEL_SECOND_SLOTS, TIMING_WHEEL_MINUTE_SLOTS, TIMING_WHEEL_HOUR_SLOTS, TIMING_WHEEL_DAY_SLOTS
+};
+// Ticks covered by one slot of each level
+static const long wheel_level_span[TIMING_WHEEL_LEVELS] = {
+    1,
+    TIMING_WHEEL_SECOND_SLOTS,
+    TIMING_WHEEL_SECOND_SLOTS * TIMING_WHEEL_MINUTE_SLOTS,
+    TIMING_WHEEL_SECOND_SLOTS * TIMING_WHEEL_MINUTE_SLOTS * TIMING_WHEEL_HOUR_SLOTS
+};
+// Index of each level's first slot in wheel->slots
+static const int wheel_level_offset[TIMING_WHEEL_LEVELS] = {
+    0,
+    TIMING_WHEEL_SECOND_SLOTS,
+    TIMING_WHEEL_SECOND_SLOTS + TIMING_WHEEL_MINUTE_SLOTS,
+    TIMING_WHEEL_SECOND_SLOTS + TIMING_WHEEL_MINUTE_SLOTS + TIMING_WHEEL_HOUR_SLOTS
+};
+
+static void wheel_list_init(WheelNode *head) {
+    head->prev = head;
+    head->next = head;
+}
+
+static void wheel_list_append(WheelNode *head, WheelNode *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void wheel_list_unlink(WheelNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+// Round up so an entry never expires before its due time
+static long wheel_tick_of(time_t when) {
+    return (long)((when + TIMING_WHEEL_TICK - 1) / TIMING_WHEEL_TICK);
+}
+
+void wheel_node_init(WheelNode *node, void *owner) {
+    node->prev = NULL;
+    node->next = NULL;
+    node->due = 0;
+    node->owner = owner;
+}
+
+int wheel_node_pending(const WheelNode *node) {
+    return node->next != NULL;
+}
+
+void timing_wheel_init(TimingWheel *wheel, time_t now) {
+    wheel->current_tick = (long)(now / TIMING_WHEEL_TICK);
+    wheel->count = 0;
+    for (int i = 0; i < TIMING_WHEEL_TOTAL_SLOTS; i++) {
+        wheel_list_init(&wheel->slots[i]);
+    }
+    wheel_list_init(&wheel->overflow);
+    wheel_list_init(&wheel->expired);
+}
+
+// Picks the list for an entry given how far its tick is from the current one
+static WheelNode* wheel_bucket_for(TimingWheel *wheel, long tick) {
+    long delta = tick - wheel->current_tick;
+    if (delta <= 0) return &wheel->expired;
+
+    for (int level = 0; level < TIMING_WHEEL_LEVELS; level++) {
+        long span = wheel_level_span[level];
+        if (delta < span * wheel_level_slots[level]) {
+            int slot = (int)((tick / span) % wheel_level_slots[level]);
+            return &wheel->slots[wheel_level_offset[level] + slot];
+        }
+    }
+    return &wheel->overflow;
+}
+
+void timing_wheel_insert(TimingWheel *wheel, WheelNode *node, time_t due) {
+    if (wheel_node_pending(node)) {
+        wheel_list_unlink(node);
+        wheel->count--;
+    }
+
+    node->due = due;
+    wheel_list_append(wheel_bucket_for(wheel, wheel_tick_of(due)), node);
+    wheel->count++;
+}
+
+void timing_wheel_cancel(TimingWheel *wheel, WheelNode *node) {
+    if (!wheel_node_pending(node)) return;
+
+    wheel_list_unlink(node);
+    wheel->count--;
+}
+
+// Re-files every entry of a list relative to the current tick
+static void wheel_cascade(TimingWheel *wheel, WheelNode *head) {
+    WheelNode pending;
+    wheel_list_init(&pending);
+
+    // Detach first, entries may land back in the same list
+    if (head->next != head) {
+        pending.next = head->next;
+        pending.prev = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        wheel_list_init(head);
+    }
+
+    while (pending.next != &pending) {
+        WheelNode *node = pending.next;
+        wheel_list_unlink(node);
+        wheel_list_append(wheel_bucket_for(wheel, wheel_tick_of(node->due)), node);
+    }
+}
+
+void timing_wheel_advance(TimingWheel *wheel, time_t now) {
+    long target = (long)(now / TIMING_WHEEL_TICK);
+
+    while (wheel->current_tick < target) {
+        long tick = ++wheel->current_tick;
+
+        // Top level first: what it cascades may land in a lower slot expiring now
+        long top_span = wheel_level_span[TIMING_WHEEL_LEVELS - 1];
+        if (tick % top_span == 0) {
+            wheel_cascade(wheel, &wheel->overflow);
+        }
+        for (int level = TIMING_WHEEL_LEVELS - 1; level > 0; level--) {
+            long span = wheel_level_span[level];
+            if (tick % span == 0) {
+                int slot = (int)((tick / span) % wheel_level_slots[level]);
+                wheel_cascade(wheel, &wheel->slots[wheel_level_offset[level] + slot]);
+            }
+        }
+
+        wheel_cascade(wheel, &wheel->slots[tick % TIMING_WHEEL_SECOND_SLOTS]);
+    }
+}
+
+WheelNode* timing_wheel_pop_expired(TimingWheel *wheel) {
+    WheelNode *node = wheel->expired.next;
+    if (node == &wheel->expired) return NULL;
+
+    wheel_list_unlink(node);
+    wheel->count--;
+    return node;
+}
+
+// Earliest time something may expire: the first non-empty slot of the lowest
+// level, or the first boundary where a non-empty upper slot cascades down.
+// -1 when the wheel is empty.
+time_t timing_wheel_next_wakeup(const TimingWheel *wheel) {
+    if (wheel->count == 0) return -1;
+    if (wheel->expired.next != &wheel->expired) return (time_t)wheel->current_tick * TIMING_WHEEL_TICK;
+
+    long earliest = -1;
+    for (int level = 0; level < TIMING_WHEEL_LEVELS; level++) {
+        long span = wheel_level_span[level];
+        int slots = wheel_level_slots[level];
+
+        // An entry in a slot cascades (or expires) at that slot's next boundary,
+        // which is at most one full turn of the level away
+        for (int step = 1; step <= slots; step++) {
+            long boundary = (wheel->current_tick / span + step) * span;
+            if (earliest != -1 && boundary >= earliest) break;
+
+            const WheelNode *slot = &wheel->slots[wheel_level_offset[level] + (boundary / span) % slots];
+            if (slot->next != slot) {
+                earliest = boundary;
+                break;
+            }
+        }
+    }
+
+    if (wheel->overflow.next != &wheel->overflow) {
+        long top_span = wheel_level_span[TIMING_WHEEL_LEVELS - 1];
+        long boundary = (wheel->current_tick / top_span + 1) * top_span;
+        if (earliest == -1 || boundary < earliest) earliest = boundary;
+    }
+
+    return (time_t)earliest * TIMING_WHEEL_TICK;
+}
@@ -0,0 +1,44 @@
+#ifndef CONDUIT_TIMING_WHEEL_H
+#define CONDUIT_TIMING_WHEEL_H
+
+#include <time.h>
+
+// One wheel tick, cron schedules fire at most once a second
+#define TIMING_WHEEL_TICK 1
+// Second, minute, hour and day levels; anything further away waits in an overflow list
+#define TIMING_WHEEL_LEVELS 4
+#define TIMING_WHEEL_SECOND_SLOTS 60
+#define TIMING_WHEEL_MINUTE_SLOTS 60
+#define TIMING_WHEEL_HOUR_SLOTS 24
+#define TIMING_WHEEL_DAY_SLOTS 64
+#define TIMING_WHEEL_TOTAL_SLOTS (TIMING_WHEEL_SECOND_SLOTS + TIMING_WHEEL_MINUTE_SLOTS + \
+                                  TIMING_WHEEL_HOUR_SLOTS + TIMING_WHEEL_DAY_SLOTS)
+
+// Node embedded in whatever gets scheduled, owner points back to it
+typedef struct WheelNode {
+    struct WheelNode *prev;
+    struct WheelNode *next;
+    time_t due;
+    void *owner;
+} WheelNode;
+
+// Hierarchical timing wheel: O(1) insert and cancel, entries cascade from
+// the day level down to the second level as their due time gets closer
+typedef struct TimingWheel {
+    long current_tick;  // last tick already expired
+    int count;
+    WheelNode slots[TIMING_WHEEL_TOTAL_SLOTS];
+    WheelNode overflow;
+    WheelNode expired;  // due entries waiting to be popped
+} TimingWheel;
+
+void wheel_node_init(WheelNode *node, void *owner);
+int wheel_node_pending(const WheelNode *node);
+void timing_wheel_init(TimingWheel *wheel, time_t now);
+void timing_wheel_insert(TimingWheel *wheel, WheelNode *node, time_t due);
+void timing_wheel_cancel(TimingWheel *wheel, WheelNode *node);
+void timing_wheel_advance(TimingWheel *wheel, time_t now);
+WheelNode* timing_wheel_pop_expired(TimingWheel *wheel);
+time_t timing_wheel_next_wakeup(const TimingWheel *wheel);
+
+#endif
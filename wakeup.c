@@ -0,0 +1,109 @@
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "wakeup.h"
+#include "clock_source.h"
+#include "logger.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+static void wakeup_open(SchedulerWakeup *wakeup) {
+    wakeup->initialized = 1;
+    wakeup->timer_fd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+    wakeup->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (wakeup->timer_fd < 0 || wakeup->event_fd < 0) {
+        log_message("timerfd unavailable, falling back to condition waits\n");
+        if (wakeup->timer_fd >= 0) close(wakeup->timer_fd);
+        if (wakeup->event_fd >= 0) close(wakeup->event_fd);
+        wakeup->timer_fd = -1;
+        wakeup->event_fd = -1;
+    }
+}
+
+static int wakeup_wait_fd(SchedulerWakeup *wakeup, pthread_mutex_t *mutex, const struct timespec *deadline) {
+    // An all zero value disarms the timer; CANCEL_ON_SET reports clock jumps
+    // so the caller recomputes instead of sleeping on a stale deadline
+    struct itimerspec spec = { 0 };
+    if (deadline) {
+        spec.it_value = *deadline;
+        if (spec.it_value.tv_sec <= 0) spec.it_value.tv_sec = 1;
+    }
+    if (timerfd_settime(wakeup->timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, NULL) != 0) {
+        log_message("Failed to arm scheduler timer: errno %d\n", errno);
+        return 0;
+    }
+
+    struct pollfd fds[2] = {
+        { .fd = wakeup->timer_fd, .events = POLLIN },
+        { .fd = wakeup->event_fd, .events = POLLIN },
+    };
+
+    // Notifications sent after the unlock stay counted in the eventfd
+    pthread_mutex_unlock(mutex);
+    int ready = poll(fds, 2, -1);
+    pthread_mutex_lock(mutex);
+    if (ready <= 0) return 0;
+
+    uint64_t value;
+    if (fds[1].revents & POLLIN) {
+        if (read(wakeup->event_fd, &value, sizeof(value)) < 0) {
+            // Already drained, nothing to do
+        }
+    }
+    if (fds[0].revents & POLLIN) {
+        // Fails with ECANCELED when the clock was set
+        return read(wakeup->timer_fd, &value, sizeof(value)) == sizeof(value);
+    }
+    return 0;
+}
+#else
+static void wakeup_open(SchedulerWakeup *wakeup) {
+    wakeup->initialized = 1;
+}
+#endif
+
+int wakeup_wait(SchedulerWakeup *wakeup, pthread_mutex_t *mutex, const struct timespec *deadline) {
+    ClockSourceMode mode = clock_source_mode();
+    if (mode == CLOCK_SOURCE_VIRTUAL) return clock_virtual_wait(mutex, deadline, &wakeup->notified);
+
+    // Accelerated deadlines are armed on the wall clock instant they fall on
+    struct timespec real_deadline;
+    if (deadline && mode == CLOCK_SOURCE_ACCELERATED) {
+        clock_source_to_real(deadline, &real_deadline);
+        deadline = &real_deadline;
+    }
+
+    if (!wakeup->initialized) wakeup_open(wakeup);
+
+#ifdef __linux__
+    if (wakeup->timer_fd >= 0) return wakeup_wait_fd(wakeup, mutex, deadline);
+#endif
+
+    if (!deadline) {
+        pthread_cond_wait(&wakeup->changed, mutex);
+        return 0;
+    }
+    return pthread_cond_timedwait(&wakeup->changed, mutex, deadline) == ETIMEDOUT;
+}
+
+void wakeup_notify(SchedulerWakeup *wakeup) {
+    if (clock_source_mode() == CLOCK_SOURCE_VIRTUAL) {
+        clock_virtual_notify(&wakeup->notified);
+        return;
+    }
+
+#ifdef __linux__
+    if (wakeup->event_fd >= 0) {
+        uint64_t one = 1;
+        if (write(wakeup->event_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated, the waiter is already due to wake up
+        }
+        return;
+    }
+#endif
+    pthread_cond_signal(&wakeup->changed);
+}
@@ -0,0 +1,30 @@
+#ifndef CONDUIT_WAKEUP_H
+#define CONDUIT_WAKEUP_H
+
+#include <pthread.h>
+#include <time.h>
+
+// Puts a scheduler thread to sleep until an absolute wall clock deadline or
+// until another thread reports a change. On Linux the deadline is a timerfd
+// armed on CLOCK_REALTIME with an eventfd for the notifications, so wakeups
+// land within the timer slack (~50us) of the second they are due. Elsewhere,
+// or if the descriptors can't be created, it falls back to the condition.
+// Deadlines are read on the configured clock source (clock_source.h).
+typedef struct SchedulerWakeup {
+    pthread_cond_t changed;
+    int timer_fd;
+    int event_fd;
+    int initialized;
+    int notified;   // pending notification while on virtual time
+} SchedulerWakeup;
+
+#define SCHEDULER_WAKEUP_INITIALIZER { PTHREAD_COND_INITIALIZER, -1, -1, 0, 0 }
+
+// Both must be called with the mutex protecting the schedule held.
+// wakeup_wait releases it while sleeping and returns 1 once the absolute
+// deadline passed on clock_now_precise(), 0 when woken early. A NULL deadline
+// waits for a notification only.
+int wakeup_wait(SchedulerWakeup *wakeup, pthread_mutex_t *mutex, const struct timespec *deadline);
+void wakeup_notify(SchedulerWakeup *wakeup);
+
+#endif
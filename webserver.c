@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <ctype.h>
 #include <cjson/cJSON.h>
 #include "mongoose.h"
 #include "database.h"
@@ -10,6 +11,7 @@
 #include "transactions.h"
 #include "dag.h"
 #include "dag_scheduler.h"
+#include "task_executor.h"
 
 // Global database pointer for the webserver
 static sqlite3 *g_db = NULL;
@@ -97,6 +99,12 @@ static void create_task_handler(struct mg_connection *c, struct mg_http_message
             continue;
         }
 
+        CronSchedule schedule;
+        if (cron_compile_seeded(cronExpression->valuestring, taskName->valuestring, &schedule) != 0) {
+            error_count++;
+            continue;
+        }
+
         Task task;
         memset(&task, 0, sizeof(Task));
         task.next = NULL;
@@ -258,6 +266,97 @@ static void dag_delete_handler(struct mg_connection *c, struct mg_http_message *
 
 // DAG Management Handlers
 
+// Task name and position in a create request, sorted to resolve
+// dependencies by name
+typedef struct TaskNameEntry {
+    const char *name;
+    int position;
+} TaskNameEntry;
+
+static int compare_task_names(const void *a, const void *b) {
+    const TaskNameEntry *left = a, *right = b;
+    int order = strcmp(left->name, right->name);
+    return order ? order : left->position - right->position;
+}
+
+// Position of the first task called name, -1 when there is none
+static int find_task_name(const TaskNameEntry *names, int count, const char *name) {
+    int low = 0, high = count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (strcmp(names[middle].name, name) < 0) low = middle + 1;
+        else high = middle;
+    }
+    return low < count && strcmp(names[low].name, name) == 0 ? names[low].position : -1;
+}
+
+// Retry settings of a task object, each one optional
+static int valid_task_retries(const cJSON *task_obj) {
+    const cJSON *retries = cJSON_GetObjectItem(task_obj, "retries");
+    const cJSON *delay = cJSON_GetObjectItem(task_obj, "retry_delay_seconds");
+    const cJSON *backoff = cJSON_GetObjectItem(task_obj, "retry_backoff");
+    const cJSON *max_delay = cJSON_GetObjectItem(task_obj, "max_retry_delay_seconds");
+
+    if (retries && (!cJSON_IsNumber(retries) || retries->valueint < 0 || retries->valueint > DAG_MAX_TASK_RETRIES)) {
+        return 0;
+    }
+    if (delay && (!cJSON_IsNumber(delay) || delay->valueint < 0)) return 0;
+    if (backoff && (!cJSON_IsNumber(backoff) || !(backoff->valuedouble >= 1))) return 0;
+    if (max_delay && (!cJSON_IsNumber(max_delay) || max_delay->valueint < 0)) return 0;
+    return 1;
+}
+
+// Cache settings of a task object: inputs, a list of paths that joined one
+// per line fits a task, and output, a path, only next to inputs
+static int valid_task_cache(const cJSON *task_obj) {
+    const cJSON *inputs = cJSON_GetObjectItem(task_obj, "inputs");
+    const cJSON *output = cJSON_GetObjectItem(task_obj, "output");
+
+    if (inputs) {
+        if (!cJSON_IsArray(inputs) || cJSON_GetArraySize(inputs) == 0) return 0;
+        size_t total = 0;
+        const cJSON *input;
+        cJSON_ArrayForEach(input, inputs) {
+            if (!cJSON_IsString(input) || !input->valuestring[0] || strchr(input->valuestring, '\n')) return 0;
+            total += strlen(input->valuestring) + 1;
+        }
+        if (total > MAX_TASK_INPUTS_LENGTH) return 0;
+    }
+    if (output) {
+        if (!inputs || !cJSON_IsString(output) || !output->valuestring[0]) return 0;
+        if (strlen(output->valuestring) >= MAX_TASK_PATH_LENGTH) return 0;
+    }
+    return 1;
+}
+
+// Pool names are written into JSON as they are, so they stay plain
+static int valid_pool_name(const char *name) {
+    size_t length = strlen(name);
+    if (length == 0 || length >= MAX_POOL_NAME_LENGTH) return 0;
+    for (const char *p = name; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_' && *p != '-' && *p != '.') return 0;
+    }
+    return 1;
+}
+
+// Error body naming why the dependencies were rejected. The reason quotes
+// task names as they were sent, so cJSON escapes it. Caller frees.
+static char* invalid_dependencies_json(const char *reason) {
+    size_t size = strlen(reason) + sizeof("Invalid DAG dependencies: ");
+    char *message = malloc(size);
+    cJSON *response = cJSON_CreateObject();
+    char *body = NULL;
+    if (message && response) {
+        snprintf(message, size, "Invalid DAG dependencies: %s", reason);
+        cJSON_AddBoolToObject(response, "error", 1);
+        cJSON_AddStringToObject(response, "message", message);
+        body = cJSON_PrintUnformatted(response);
+    }
+    free(message);
+    cJSON_Delete(response);
+    return body;
+}
+
 static void create_dag_handler(struct mg_connection *c, struct mg_http_message *hm) {
     if (mg_strcmp(hm->method, mg_str("POST")) != 0) {
         send_json_response(c, 405, RESPONSE_ERROR_METHOD_NOT_ALLOWED);
@@ -296,6 +395,9 @@ static void create_dag_handler(struct mg_connection *c, struct mg_http_message *
     cJSON *name = cJSON_GetObjectItem(json, "name");
     cJSON *cron_expression = cJSON_GetObjectItem(json, "cron_expression");
     cJSON *description = cJSON_GetObjectItem(json, "description");
+    cJSON *max_parallel_tasks = cJSON_GetObjectItem(json, "max_parallel_tasks");
+    cJSON *max_active_runs = cJSON_GetObjectItem(json, "max_active_runs");
+    cJSON *overlap_policy = cJSON_GetObjectItem(json, "overlap_policy");
     cJSON *tasks = cJSON_GetObjectItem(json, "tasks");
 
     if (!name || !cJSON_IsString(name)) {
@@ -310,12 +412,73 @@ static void create_dag_handler(struct mg_connection *c, struct mg_http_message *
         return;
     }
 
+    CronSchedule schedule;
+    if (cron_compile_seeded(cron_expression->valuestring, name->valuestring, &schedule) != 0) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_CRON_EXPRESSION);
+        return;
+    }
+
+    if (max_parallel_tasks && (!cJSON_IsNumber(max_parallel_tasks) || max_parallel_tasks->valueint < 0)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_MAX_PARALLEL_TASKS);
+        return;
+    }
+
+    if (max_active_runs && (!cJSON_IsNumber(max_active_runs) || max_active_runs->valueint < 0)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_MAX_ACTIVE_RUNS);
+        return;
+    }
+
+    int policy = -1;
+    if (overlap_policy) {
+        policy = cJSON_IsString(overlap_policy) ? string_to_overlap_policy(overlap_policy->valuestring) : -1;
+        if (policy < 0) {
+            cJSON_Delete(json);
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_OVERLAP_POLICY);
+            return;
+        }
+    }
+
     if (!tasks || !cJSON_IsArray(tasks)) {
         cJSON_Delete(json);
         send_json_response(c, 400, RESPONSE_ERROR_MISSING_TASKS);
         return;
     }
 
+    cJSON *task_obj;
+    cJSON_ArrayForEach(task_obj, tasks) {
+        cJSON *pool = cJSON_GetObjectItem(task_obj, "pool");
+        if (pool && (!cJSON_IsString(pool) || !valid_pool_name(pool->valuestring))) {
+            cJSON_Delete(json);
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_POOL_NAME);
+            return;
+        }
+        if (!valid_task_retries(task_obj)) {
+            cJSON_Delete(json);
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_TASK_RETRIES);
+            return;
+        }
+        cJSON *timeout = cJSON_GetObjectItem(task_obj, "timeout_seconds");
+        if (timeout && (!cJSON_IsNumber(timeout) || timeout->valueint < 0)) {
+            cJSON_Delete(json);
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_TASK_TIMEOUT);
+            return;
+        }
+        cJSON *trigger_rule = cJSON_GetObjectItem(task_obj, "trigger_rule");
+        if (trigger_rule && (!cJSON_IsString(trigger_rule) || string_to_trigger_rule(trigger_rule->valuestring) < 0)) {
+            cJSON_Delete(json);
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_TRIGGER_RULE);
+            return;
+        }
+        if (!valid_task_cache(task_obj)) {
+            cJSON_Delete(json);
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_TASK_CACHE);
+            return;
+        }
+    }
+
     // Create DAG
     DAG *dag = create_dag(name->valuestring, cron_expression->valuestring, 
                          description ? description->valuestring : "");
@@ -324,24 +487,29 @@ static void create_dag_handler(struct mg_connection *c, struct mg_http_message *
         send_json_response(c, 500, RESPONSE_ERROR_DAG_CREATE_FAILED);
         return;
     }
-
-    // Insert DAG into database
-    int dag_id = insert_dag_db(g_db, dag);
-    if (dag_id < 0) {
-        free_dag(dag);
-        cJSON_Delete(json);
-        send_json_response(c, 500, RESPONSE_ERROR_DAG_CREATE_FAILED);
-        return;
+    if (max_parallel_tasks) {
+        dag->max_parallel_tasks = max_parallel_tasks->valueint;
+    }
+    if (max_active_runs) {
+        dag->max_active_runs = max_active_runs->valueint;
+    }
+    if (policy >= 0) {
+        dag->overlap_policy = policy;
     }
 
-    // Process tasks in two phases: first create all tasks, then resolve dependencies
+    // Process tasks in memory first, numbered by their position in the
+    // request, so the DAG is validated before anything is stored
     
     // Phase 1: Create all tasks without dependencies
     int task_count = cJSON_GetArraySize(tasks);
     DAGTask **task_array = NULL;
+    TaskNameEntry *names = NULL;
     if (task_count > 0) {
-        task_array = malloc(task_count * sizeof(DAGTask*));
-        if (!task_array) {
+        task_array = calloc(task_count, sizeof(DAGTask*));
+        names = malloc(task_count * sizeof(TaskNameEntry));
+        if (!task_array || !names) {
+            free(task_array);
+            free(names);
             free_dag(dag);
             cJSON_Delete(json);
             send_json_response(c, 500, RESPONSE_ERROR_MEMORY_ALLOCATION);
@@ -349,76 +517,141 @@ static void create_dag_handler(struct mg_connection *c, struct mg_http_message *
         }
     }
     
-    for (int i = 0; i < task_count; i++) {
-        cJSON *task_obj = cJSON_GetArrayItem(tasks, i);
-        
+    // Walked in order, cJSON_GetArrayItem would rescan the array per task
+    int name_count = 0;
+    int position = -1;
+    cJSON_ArrayForEach(task_obj, tasks) {
+        position++;
         cJSON *task_name = cJSON_GetObjectItem(task_obj, "task_name");
         cJSON *task_execution = cJSON_GetObjectItem(task_obj, "task_execution");
+        cJSON *pool = cJSON_GetObjectItem(task_obj, "pool");
 
         if (!task_name || !cJSON_IsString(task_name) ||
             !task_execution || !cJSON_IsString(task_execution)) {
-            task_array[i] = NULL;
             continue;
         }
 
-        DAGTask *dag_task = create_dag_task(dag_id, task_name->valuestring, 
+        DAGTask *dag_task = create_dag_task(0, task_name->valuestring, 
                                            task_execution->valuestring);
         if (!dag_task) {
-            task_array[i] = NULL;
             continue;
         }
 
-        // Insert task into database to get ID
-        int task_id = insert_dag_task_db(g_db, dag_task);
-        if (task_id >= 0) {
-            dag_task->id = task_id;
-            // Add to DAG task list
-            dag_task->next = dag->tasks;
-            dag->tasks = dag_task;
-            dag->task_count++;
-            task_array[i] = dag_task;
-        } else {
+        dag_task->id = position + 1;
+        if (pool) {
+            strncpy(dag_task->pool, pool->valuestring, MAX_POOL_NAME_LENGTH - 1);
+        }
+        cJSON *retries = cJSON_GetObjectItem(task_obj, "retries");
+        cJSON *retry_delay = cJSON_GetObjectItem(task_obj, "retry_delay_seconds");
+        cJSON *retry_backoff = cJSON_GetObjectItem(task_obj, "retry_backoff");
+        cJSON *max_retry_delay = cJSON_GetObjectItem(task_obj, "max_retry_delay_seconds");
+        if (retries) dag_task->retries = retries->valueint;
+        if (retry_delay) dag_task->retry_delay_seconds = retry_delay->valueint;
+        if (retry_backoff) dag_task->retry_backoff = retry_backoff->valuedouble;
+        if (max_retry_delay) dag_task->max_retry_delay_seconds = max_retry_delay->valueint;
+        cJSON *timeout = cJSON_GetObjectItem(task_obj, "timeout_seconds");
+        if (timeout) dag_task->timeout_seconds = timeout->valueint;
+        cJSON *trigger_rule = cJSON_GetObjectItem(task_obj, "trigger_rule");
+        if (trigger_rule) dag_task->trigger_rule = string_to_trigger_rule(trigger_rule->valuestring);
+        cJSON *inputs = cJSON_GetObjectItem(task_obj, "inputs");
+        cJSON *output = cJSON_GetObjectItem(task_obj, "output");
+        char joined_inputs[MAX_TASK_INPUTS_LENGTH] = "";
+        cJSON *input;
+        size_t inputs_length = 0;
+        cJSON_ArrayForEach(input, inputs) {
+            inputs_length += snprintf(joined_inputs + inputs_length, sizeof(joined_inputs) - inputs_length,
+                                      "%s%s", inputs_length ? "\n" : "", input->valuestring);
+        }
+        if (set_dag_task_cache(dag_task, joined_inputs, output ? output->valuestring : NULL) != 0) {
             free_dag_task(dag_task);
-            task_array[i] = NULL;
+            continue;
         }
+        dag_task->next = dag->tasks;
+        dag->tasks = dag_task;
+        dag->task_count++;
+        task_array[position] = dag_task;
+        names[name_count++] = (TaskNameEntry){ dag_task->task_name, position };
     }
+    qsort(names, name_count, sizeof(TaskNameEntry), compare_task_names);
     
-    // Phase 2: Resolve dependencies by name and update database
-    for (int i = 0; i < task_count; i++) {
-        if (!task_array[i]) continue;
+    // Phase 2: Resolve dependencies by name, the first task of a name wins
+    position = -1;
+    cJSON_ArrayForEach(task_obj, tasks) {
+        position++;
+        if (!task_array[position]) continue;
         
-        cJSON *task_obj = cJSON_GetArrayItem(tasks, i);
         cJSON *dependencies = cJSON_GetObjectItem(task_obj, "dependencies");
-
-        if (dependencies && cJSON_IsArray(dependencies)) {
-            int dep_count = cJSON_GetArraySize(dependencies);
-            for (int j = 0; j < dep_count; j++) {
-                cJSON *dep = cJSON_GetArrayItem(dependencies, j);
-                if (cJSON_IsString(dep)) {
-                    // Find the task with this name
-                    const char *dep_name = dep->valuestring;
-                    for (int k = 0; k < task_count; k++) {
-                        if (task_array[k] && strcmp(task_array[k]->task_name, dep_name) == 0) {
-                            add_task_dependency(task_array[i], task_array[k]->id, dep_name);
-                            break;
-                        }
-                    }
-                }
+        cJSON *dep;
+        cJSON_ArrayForEach(dep, dependencies) {
+            if (!cJSON_IsString(dep)) continue;
+            int k = find_task_name(names, name_count, dep->valuestring);
+            if (k >= 0) {
+                add_task_dependency(task_array[position], k + 1, dep->valuestring);
             }
-            
-            // Update the task dependencies in database
-            insert_dag_task_db(g_db, task_array[i]); // This will update the dependencies JSON
         }
     }
+    free(names);
+    
+    // Reject cycles before anything is stored
+    CompiledDAG *plan = compile_dag(dag);
+    if (!plan || !plan->valid) {
+        char *error_body = plan && plan->error ? invalid_dependencies_json(plan->error) : NULL;
+        dag_plan_release(plan);
+        free(task_array);
+        free_dag(dag);
+        cJSON_Delete(json);
+        if (plan) {
+            send_json_response(c, 400, error_body ? error_body : RESPONSE_ERROR_DAG_INVALID_DEPENDENCIES);
+            free(error_body);
+        } else {
+            send_json_response(c, 500, RESPONSE_ERROR_MEMORY_ALLOCATION);
+        }
+        return;
+    }
+    dag_plan_release(plan);
+
+    // Insert DAG into database
+    int dag_id = insert_dag_db(g_db, dag);
+    int *task_ids = task_count > 0 ? malloc(task_count * sizeof(int)) : NULL;
+    if (dag_id < 0 || (task_count > 0 && !task_ids)) {
+        free(task_ids);
+        free(task_array);
+        free_dag(dag);
+        cJSON_Delete(json);
+        send_json_response(c, 500, RESPONSE_ERROR_DAG_CREATE_FAILED);
+        return;
+    }
+
+    // Phase 3: Insert the tasks, then store their dependencies under the
+    // ids the database gave them
+    for (int i = 0; i < task_count; i++) {
+        task_ids[i] = -1;
+        if (!task_array[i]) continue;
+        
+        TaskDependency *dependencies = task_array[i]->dependencies;
+        task_array[i]->dependencies = NULL;
+        task_array[i]->dag_id = dag_id;
+        task_ids[i] = insert_dag_task_db(g_db, task_array[i]);
+        task_array[i]->dependencies = dependencies;
+    }
+    for (int i = 0; i < task_count; i++) {
+        if (!task_array[i] || task_ids[i] < 0 || !task_array[i]->dependencies) continue;
+        
+        for (TaskDependency *dep = task_array[i]->dependencies; dep; dep = dep->next) {
+            dep->task_id = task_ids[dep->task_id - 1];
+        }
+        insert_task_dependencies_db(g_db, task_ids[i], task_array[i]->dependencies);
+    }
     
+    free(task_ids);
     free(task_array);
 
     char response_buffer[256];
     snprintf(response_buffer, sizeof(response_buffer), RESPONSE_DAG_SUCCESS_CREATED, dag_id);
     send_json_response(c, 201, response_buffer);
 
-    // Reload DAGs in scheduler
-    reload_dags(g_db);
+    // Schedule the new DAG
+    refresh_dag(g_db, dag_id);
 
     free_dag(dag);
     cJSON_Delete(json);
@@ -435,6 +668,90 @@ static void get_dags_handler(struct mg_connection *c, struct mg_http_message *hm
     free(json_data);
 }
 
+static void schedule_forecast_handler(struct mg_connection *c, struct mg_http_message *hm) {
+    int hours = 24;
+    char hours_str[16];
+    if (mg_http_get_var(&hm->query, "hours", hours_str, sizeof(hours_str)) > 0) {
+        char *end;
+        long value = strtol(hours_str, &end, 10);
+        if (*end != '\0' || value < 1 || value > SCHEDULE_FORECAST_MAX_HOURS) {
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_FORECAST_HOURS);
+            return;
+        }
+        hours = (int)value;
+    }
+
+    char *json_data = get_schedule_forecast_json(hours);
+    if (!json_data) {
+        send_json_response(c, 500, RESPONSE_ERROR_MEMORY_ALLOCATION);
+        return;
+    }
+
+    send_json_response(c, 200, json_data);
+    free(json_data);
+}
+
+// GET lists the pools with their occupancy and wait times, POST creates a
+// pool or changes its slots: {"name":"warehouse","slots":4}
+static void pools_handler(struct mg_connection *c, struct mg_http_message *hm) {
+    if (mg_strcmp(hm->method, mg_str("GET")) == 0) {
+        char *json_data = task_executor_pools_json();
+        if (!json_data) {
+            send_json_response(c, 500, RESPONSE_ERROR_MEMORY_ALLOCATION);
+            return;
+        }
+        send_json_response(c, 200, json_data);
+        free(json_data);
+        return;
+    }
+
+    if (mg_strcmp(hm->method, mg_str("POST")) != 0) {
+        send_json_response(c, 405, RESPONSE_ERROR_METHOD_NOT_ALLOWED);
+        return;
+    }
+
+    char *body_str = malloc(hm->body.len + 1);
+    if (!body_str) {
+        send_json_response(c, 500, RESPONSE_ERROR_MEMORY_ALLOCATION);
+        return;
+    }
+    memcpy(body_str, hm->body.buf, hm->body.len);
+    body_str[hm->body.len] = '\0';
+
+    cJSON *json = cJSON_Parse(body_str);
+    free(body_str);
+
+    if (!json || !cJSON_IsObject(json)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_JSON);
+        return;
+    }
+
+    cJSON *name = cJSON_GetObjectItem(json, "name");
+    cJSON *slots = cJSON_GetObjectItem(json, "slots");
+
+    if (!name || !cJSON_IsString(name) || !valid_pool_name(name->valuestring)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_POOL_NAME);
+        return;
+    }
+
+    if (!slots || !cJSON_IsNumber(slots) || slots->valueint < 1) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_POOL_SLOTS);
+        return;
+    }
+
+    if (save_pool_db(g_db, name->valuestring, slots->valueint) != 0 ||
+        task_executor_set_pool(name->valuestring, slots->valueint) != 0) {
+        send_json_response(c, 500, RESPONSE_ERROR_POOL_SAVE_FAILED);
+    } else {
+        send_json_response(c, 200, RESPONSE_POOL_SUCCESS_SAVED);
+    }
+
+    cJSON_Delete(json);
+}
+
 static void get_dag_status_handler(struct mg_connection *c, struct mg_http_message *hm) {
     // Extract DAG ID from URI path
     char uri_str[256];
@@ -449,7 +766,9 @@ static void get_dag_status_handler(struct mg_connection *c, struct mg_http_messa
         return;
     }
     
-    char *json_data = get_dag_status_json(g_db, dag_id);
+    char *runs_json = get_dag_runs_json(dag_id);
+    char *json_data = get_dag_status_json(g_db, dag_id, runs_json);
+    free(runs_json);
     if (!json_data) {
         send_json_response(c, 404, RESPONSE_ERROR_DAG_NOT_FOUND);
         return;
@@ -478,12 +797,187 @@ static void trigger_dag_handler(struct mg_connection *c, struct mg_http_message
         return;
     }
     
-    int result = trigger_dag_execution(g_db, dag_id);
+    // Returns once the run is queued, its progress shows in the DAG's status
+    char execution_id[MAX_EXECUTION_ID_LENGTH];
+    char *error = NULL;
+    int result = trigger_dag_execution(g_db, dag_id, execution_id, &error);
+    if (result == 0) {
+        char response_buffer[256];
+        snprintf(response_buffer, sizeof(response_buffer), RESPONSE_DAG_SUCCESS_TRIGGERED, execution_id);
+        send_json_response(c, 200, response_buffer);
+    } else if (result == -2) {
+        send_json_response(c, 404, RESPONSE_ERROR_DAG_NOT_FOUND);
+    } else if (result == -3) {
+        char *error_body = error ? invalid_dependencies_json(error) : NULL;
+        send_json_response(c, 400, error_body ? error_body : RESPONSE_ERROR_DAG_INVALID_DEPENDENCIES);
+        free(error_body);
+        free(error);
+    } else {
+        send_json_response(c, 500, RESPONSE_ERROR_DAG_TRIGGER_FAILED);
+    }
+}
+
+static void cancel_run_handler(struct mg_connection *c, struct mg_http_message *hm) {
+    if (mg_strcmp(hm->method, mg_str("POST")) != 0) {
+        send_json_response(c, 405, RESPONSE_ERROR_METHOD_NOT_ALLOWED);
+        return;
+    }
+
+    // Extract DAG ID and execution ID from URI path
+    char uri_str[256];
+    size_t uri_len = hm->uri.len < sizeof(uri_str) - 1 ? hm->uri.len : sizeof(uri_str) - 1;
+    memcpy(uri_str, hm->uri.buf, uri_len);
+    uri_str[uri_len] = '\0';
+
+    // Parse from /api/dag/{id}/runs/{execution_id}/cancel
+    int dag_id = 0;
+    char execution_id[64];
+    if (sscanf(uri_str, "/api/dag/%d/runs/%63[^/]/cancel", &dag_id, execution_id) != 2) {
+        send_json_response(c, 400, RESPONSE_ERROR_MISSING_ID);
+        return;
+    }
+
+    if (cancel_dag_run(dag_id, execution_id) == 0) {
+        send_json_response(c, 200, RESPONSE_RUN_SUCCESS_CANCELLED);
+    } else {
+        send_json_response(c, 404, RESPONSE_ERROR_RUN_NOT_ACTIVE);
+    }
+}
+
+static void resume_run_handler(struct mg_connection *c, struct mg_http_message *hm) {
+    if (mg_strcmp(hm->method, mg_str("POST")) != 0) {
+        send_json_response(c, 405, RESPONSE_ERROR_METHOD_NOT_ALLOWED);
+        return;
+    }
+
+    // Extract DAG ID and execution ID from URI path
+    char uri_str[256];
+    size_t uri_len = hm->uri.len < sizeof(uri_str) - 1 ? hm->uri.len : sizeof(uri_str) - 1;
+    memcpy(uri_str, hm->uri.buf, uri_len);
+    uri_str[uri_len] = '\0';
+
+    // Parse from /api/dag/{id}/runs/{execution_id}/resume
+    int dag_id = 0;
+    char execution_id[64];
+    if (sscanf(uri_str, "/api/dag/%d/runs/%63[^/]/resume", &dag_id, execution_id) != 2) {
+        send_json_response(c, 400, RESPONSE_ERROR_MISSING_ID);
+        return;
+    }
+
+    // Like a trigger, answers once the new run is queued
+    char resumed_execution_id[MAX_EXECUTION_ID_LENGTH];
+    char *error = NULL;
+    int result = resume_dag_execution(g_db, dag_id, execution_id, resumed_execution_id, &error);
     if (result == 0) {
-        send_json_response(c, 200, RESPONSE_DAG_SUCCESS_TRIGGERED);
+        char response_buffer[256];
+        snprintf(response_buffer, sizeof(response_buffer), RESPONSE_RUN_SUCCESS_RESUMED, resumed_execution_id);
+        send_json_response(c, 200, response_buffer);
+    } else if (result == -2) {
+        send_json_response(c, 404, RESPONSE_ERROR_RUN_NOT_FINISHED);
+    } else if (result == -3) {
+        char *error_body = error ? invalid_dependencies_json(error) : NULL;
+        send_json_response(c, 400, error_body ? error_body : RESPONSE_ERROR_DAG_INVALID_DEPENDENCIES);
+        free(error_body);
+        free(error);
     } else {
+        send_json_response(c, 500, RESPONSE_ERROR_RUN_RESUME_FAILED);
+    }
+}
+
+static void update_dag_handler(struct mg_connection *c, struct mg_http_message *hm) {
+    if (hm->body.len <= 0 || hm->body.len > 1024*1024) {
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_BODY);
+        return;
+    }
+
+    // Extract DAG ID from URI path
+    char uri_str[256];
+    size_t uri_len = hm->uri.len < sizeof(uri_str) - 1 ? hm->uri.len : sizeof(uri_str) - 1;
+    memcpy(uri_str, hm->uri.buf, uri_len);
+    uri_str[uri_len] = '\0';
+    
+    // Parse ID from /api/dag/{id}
+    int dag_id = 0;
+    if (sscanf(uri_str, "/api/dag/%d", &dag_id) != 1) {
+        send_json_response(c, 400, RESPONSE_ERROR_MISSING_ID);
+        return;
+    }
+
+    char *body_str = malloc(hm->body.len + 1);
+    if (!body_str) {
+        send_json_response(c, 500, RESPONSE_ERROR_MEMORY_ALLOCATION);
+        return;
+    }
+    
+    memcpy(body_str, hm->body.buf, hm->body.len);
+    body_str[hm->body.len] = '\0';
+
+    cJSON *json = cJSON_Parse(body_str);
+    free(body_str);
+    
+    if (!json || !cJSON_IsObject(json)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_JSON);
+        return;
+    }
+
+    cJSON *name = cJSON_GetObjectItem(json, "name");
+    cJSON *cron_expression = cJSON_GetObjectItem(json, "cron_expression");
+    cJSON *description = cJSON_GetObjectItem(json, "description");
+    cJSON *max_parallel_tasks = cJSON_GetObjectItem(json, "max_parallel_tasks");
+    cJSON *max_active_runs = cJSON_GetObjectItem(json, "max_active_runs");
+    cJSON *overlap_policy = cJSON_GetObjectItem(json, "overlap_policy");
+
+    if (!name || !cJSON_IsString(name) || !cron_expression || !cJSON_IsString(cron_expression)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_MISSING_FIELDS);
+        return;
+    }
+
+    CronSchedule schedule;
+    if (cron_compile_seeded(cron_expression->valuestring, name->valuestring, &schedule) != 0) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_CRON_EXPRESSION);
+        return;
+    }
+
+    if (max_parallel_tasks && (!cJSON_IsNumber(max_parallel_tasks) || max_parallel_tasks->valueint < 0)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_MAX_PARALLEL_TASKS);
+        return;
+    }
+
+    if (max_active_runs && (!cJSON_IsNumber(max_active_runs) || max_active_runs->valueint < 0)) {
+        cJSON_Delete(json);
+        send_json_response(c, 400, RESPONSE_ERROR_INVALID_MAX_ACTIVE_RUNS);
+        return;
+    }
+
+    int policy = -1;
+    if (overlap_policy) {
+        policy = cJSON_IsString(overlap_policy) ? string_to_overlap_policy(overlap_policy->valuestring) : -1;
+        if (policy < 0) {
+            cJSON_Delete(json);
+            send_json_response(c, 400, RESPONSE_ERROR_INVALID_OVERLAP_POLICY);
+            return;
+        }
+    }
+
+    int result = update_dag_db(g_db, dag_id, name->valuestring, cron_expression->valuestring,
+                               description && cJSON_IsString(description) ? description->valuestring : "",
+                               max_parallel_tasks ? max_parallel_tasks->valueint : -1,
+                               max_active_runs ? max_active_runs->valueint : -1, policy);
+    if (result == 1) {
+        // Moves the DAG's entry in the scheduler queue to its new fire time
+        refresh_dag(g_db, dag_id);
+        send_json_response(c, 200, RESPONSE_DAG_SUCCESS_UPDATED);
+    } else if (result == 0) {
         send_json_response(c, 404, RESPONSE_ERROR_DAG_NOT_FOUND);
+    } else {
+        send_json_response(c, 500, RESPONSE_ERROR_DAG_UPDATE_FAILED);
     }
+
+    cJSON_Delete(json);
 }
 
 static void delete_dag_handler(struct mg_connection *c, struct mg_http_message *hm) {
@@ -508,7 +1002,7 @@ static void delete_dag_handler(struct mg_connection *c, struct mg_http_message *
     int result = delete_dag_by_id_db(g_db, dag_id);
     if (result == 1) {
         send_json_response(c, 200, RESPONSE_DAG_SUCCESS_DELETED);
-        reload_dags(g_db);
+        refresh_dag(g_db, dag_id);
     } else if (result == 0) {
         send_json_response(c, 404, RESPONSE_ERROR_DAG_NOT_FOUND);
     } else {
@@ -539,12 +1033,24 @@ static void event_handler(struct mg_connection *c, int ev, void *ev_data) {
             }
         } else if (mg_match(hm->uri, mg_str("/api/dags"), NULL)) {
             get_dags_handler(c, hm);
+        } else if (mg_match(hm->uri, mg_str("/api/schedule/forecast"), NULL)) {
+            schedule_forecast_handler(c, hm);
+        } else if (mg_match(hm->uri, mg_str("/api/pools"), NULL)) {
+            pools_handler(c, hm);
         } else if (mg_match(hm->uri, mg_str("/api/dag/*/status"), NULL)) {
             get_dag_status_handler(c, hm);
         } else if (mg_match(hm->uri, mg_str("/api/dag/*/trigger"), NULL)) {
             trigger_dag_handler(c, hm);
+        } else if (mg_match(hm->uri, mg_str("/api/dag/*/runs/*/cancel"), NULL)) {
+            cancel_run_handler(c, hm);
+        } else if (mg_match(hm->uri, mg_str("/api/dag/*/runs/*/resume"), NULL)) {
+            resume_run_handler(c, hm);
         } else if (mg_match(hm->uri, mg_str("/api/dag/*"), NULL)) {
-            delete_dag_handler(c, hm);
+            if (mg_strcmp(hm->method, mg_str("PUT")) == 0) {
+                update_dag_handler(c, hm);
+            } else {
+                delete_dag_handler(c, hm);
+            }
         } else {
             // Handle 404 - endpoint not found
             char response_buffer[1024];
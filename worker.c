@@ -6,6 +6,7 @@
 #include <sys/wait.h>
 #include <string.h>
 #include "logger.h"
+#include "task_executor.h"
 
 #define PATH_MAX 1024
 // Thinking about creating binarys files that are executed here but idk how should i pass the other params needed in the scheduler
@@ -22,33 +23,15 @@ int is_executable(const char *path) {
     return (access(path, X_OK) == 0);
 }
 
-int execute_binary_exec(const char *path, char *const argv[]) {
+// Queued on the task executor, which waits for the process. Returns -1 when
+// the binary can't be run.
+int execute_binary_exec(const char *path) {
     if (!is_executable(path)) {
         log_message("Error: '%s' doesn't exist or isn't executable\n", path);
         return -1;
     }
 
-    pid_t pid = fork();
-
-    if (pid < 0) {
-        perror("fork failed");
-        return -1;
-    }
-
-    if (pid == 0) {
-        execv(path, argv);
-        perror("execv failed");
-        exit(EXIT_FAILURE);
-    } else {
-        int status;
-        waitpid(pid, &status, 0);
-
-        if (WIFEXITED(status)) {
-            return WEXITSTATUS(status);
-        } else {
-            return -1;
-        }
-    }
+    return task_executor_spawn_binary(path);
 }
 
 void worker(int taskId, char taskExecution[64]){
@@ -67,6 +50,7 @@ void worker(int taskId, char taskExecution[64]){
 
     log_message("Full path for binary execution %s\n", full_path);
 
-    execute_binary_exec(full_path, NULL);
+    execute_binary_exec(full_path);
+    free(full_path);
     return;
 }
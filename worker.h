@@ -1,2 +1,2 @@
 void worker(int taskId, char taskExecution[64]);
-int execute_binary_exec(const char *path, char *const argv[]);
+int execute_binary_exec(const char *path);